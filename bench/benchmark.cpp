@@ -0,0 +1,368 @@
+#include <SDL.h>
+#include <SDL_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frame_profile.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "mesh.h"
+#include "rasterizer.h"
+#include "scene.h"
+#include "span_shader.h"
+#include "texture.h"
+#include "texture_manager.h"
+#include "thread_pool.h"
+#include "tile_renderer.h"
+
+// Headless benchmark: renders fixed camera paths in every mapping mode and
+// reports per-stage timings and how far each mode strays from exact
+// perspective. Uses the dummy video driver unless
+// SDL_VIDEODRIVER says otherwise, so it runs without a display.
+
+#ifndef BENCHMARK_TEXTURE
+#define BENCHMARK_TEXTURE "happy.png"
+#endif
+
+const int SCREEN_WIDTH = 1280;
+const int SCREEN_HEIGHT = 720;
+
+struct CameraPath {
+    const char* name;
+    glm::vec3 start, end;   // camera moves linearly from start to end over the run
+    bool orbit;             // or circles the square at start's radius and height
+    float rollDegrees;      // camera roll about the line of sight
+};
+
+// Without roll every screen row of the square runs parallel to its horizon,
+// so depth is constant along spans and subdivided mapping is exact there.
+// The banked paths tilt the horizon so depth changes along every row.
+const CameraPath CAMERA_PATHS[] = {
+    {"default", glm::vec3(2.0f, 2.0f, 6.0f), glm::vec3(2.0f, 2.0f, 6.0f), false, 0.0f},
+    {"closeup", glm::vec3(0.4f, 0.4f, 1.4f), glm::vec3(0.4f, 0.4f, 1.4f), false, 0.0f},
+    {"far", glm::vec3(8.0f, 8.0f, 24.0f), glm::vec3(8.0f, 8.0f, 24.0f), false, 0.0f},
+    {"dolly", glm::vec3(3.0f, 3.0f, 14.0f), glm::vec3(0.4f, 0.4f, 1.4f), false, 0.0f},
+    {"orbit", glm::vec3(4.0f, 0.0f, 3.0f), glm::vec3(4.0f, 0.0f, 3.0f), true, 0.0f},
+    {"banked", glm::vec3(2.4f, 0.0f, 0.9f), glm::vec3(2.4f, 0.0f, 0.9f), false, 35.0f},
+    {"banked_orbit", glm::vec3(2.0f, 0.0f, 1.2f), glm::vec3(2.0f, 0.0f, 1.2f), true, 60.0f},
+};
+
+struct ScenarioResult {
+    std::string path;
+    std::string mode;
+    int subdivisionStep = 0;                // 0 unless subdivided
+    int frames = 0;
+    double pixelsPerFrame = 0.0;
+    double nsPerPixel = 0.0;
+    double megapixelsPerSecond = 0.0;
+    double frameMilliseconds[4] = {};       // p50, p90, p99, max
+    double stageNanoseconds[PROFILE_STAGE_COUNT] = {};   // mean per frame
+    double texelErrorMax = 0.0;
+    double texelErrorMean = 0.0;
+};
+
+// Distance in base-level texels between the coordinates a mode shades with
+// and exact perspective, over every covered pixel
+struct MappingError {
+    double max = 0.0;
+    double sum = 0.0;
+    int64_t pixels = 0;
+};
+
+struct Options {
+    int frames = 240;
+    int warmupFrames = 10;
+    int threads = 1;
+    bool json = false;
+    std::string texturePath = BENCHMARK_TEXTURE;
+    std::string meshName = "quad";
+    SimdLevel simdLevel = detectSimdLevel();
+    PixelPipelineState pipeline;    // mapping is swept, the rest is fixed per run
+    std::vector<int> subdivisionSteps = {8, 16, 32};
+};
+
+SceneView viewAt(const CameraPath& path, int frame, int frameCount) {
+    float u = frameCount > 1 ? static_cast<float>(frame) / static_cast<float>(frameCount - 1) : 0.0f;
+    SceneView view;
+    if (path.orbit) {
+        float radius = glm::length(glm::vec2(path.start.x, path.start.y));
+        float angle = glm::two_pi<float>() * u;
+        view.cameraPosition = glm::vec3(radius * std::cos(angle), radius * std::sin(angle), path.start.z);
+    } else {
+        view.cameraPosition = glm::mix(path.start, path.end, u);
+    }
+    view.rotationAngle = static_cast<float>(frame) * SCENE_ANGULAR_SPEED;
+    view.cameraRoll = glm::radians(path.rollDegrees);
+    return view;
+}
+
+void measureMappingError(const TileRenderer& tileRenderer, const PixelPipelineState& pipeline, MappingError& error) {
+    std::vector<TexCoord> shaded(TILE_SIZE);
+    std::vector<TexCoord> exact(TILE_SIZE);
+    const ClipRect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    for (const DrawTriangle& triangle : tileRenderer.frameTriangles()) {
+        const TextureView& base = triangle.texture->level(0);
+        rasterizeTriangle(triangle.setup, screen, [&](int y, int x0, int x1) {
+            // Cut at tile edges like TileRenderer::shadeSpan, which decides
+            // where subdivided spans divide
+            while (x0 < x1) {
+                int segmentEnd = std::min((x0 / TILE_SIZE + 1) * TILE_SIZE, x1);
+                mapSpanTexCoords(triangle.setup, pipeline.mapping, pipeline.subdivisionStep, y, x0, segmentEnd, shaded.data());
+                mapSpanTexCoords(triangle.setup, MappingMode::Perspective, 0, y, x0, segmentEnd, exact.data());
+                for (int i = 0; i < segmentEnd - x0; ++i) {
+                    double ds = (static_cast<double>(shaded[i].s) - exact[i].s) * base.width;
+                    double dt = (static_cast<double>(shaded[i].t) - exact[i].t) * base.height;
+                    double distance = std::sqrt(ds * ds + dt * dt);
+                    error.max = std::max(error.max, distance);
+                    error.sum += distance;
+                }
+                error.pixels += segmentEnd - x0;
+                x0 = segmentEnd;
+            }
+        });
+    }
+}
+
+double percentile(const std::vector<int64_t>& sorted, double fraction) {
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return static_cast<double>(sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1]);
+}
+
+bool parseOptions(int argc, char* args[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = args[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::max(std::atoi(args[++i]), 1);
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = std::max(std::atoi(args[++i]), 0);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = std::max(std::atoi(args[++i]), 1);
+        } else if (arg == "--format" && hasValue) {
+            options.json = std::strcmp(args[++i], "json") == 0;
+        } else if (arg == "--mesh" && hasValue) {
+            options.meshName = args[++i];
+        } else if (arg == "--texture" && hasValue) {
+            options.texturePath = args[++i];
+        } else if (arg == "--simd" && hasValue) {
+            std::string level = args[++i];
+            SimdLevel requested = level == "avx2" ? SimdLevel::AVX2 : level == "sse2" ? SimdLevel::SSE2 : SimdLevel::Scalar;
+            // Never pick a level the CPU cannot run
+            options.simdLevel = std::min(requested, detectSimdLevel());
+        } else if (arg == "--subdivision" && hasValue) {
+            // Comma-separated steps, each run as its own subdivided mode and
+            // rounded up to a step the shaders are compiled for
+            options.subdivisionSteps.clear();
+            for (char* step = std::strtok(args[++i], ","); step; step = std::strtok(nullptr, ","))
+                options.subdivisionSteps.push_back(SPAN_SUBDIVISION_STEPS[subdivisionStepIndex(std::atoi(step))]);
+        } else if (arg == "--filter" && hasValue) {
+            options.pipeline.filter = std::strcmp(args[++i], "bilinear") == 0 ? TextureFilter::Bilinear : TextureFilter::Nearest;
+        } else if (arg == "--address" && hasValue) {
+            options.pipeline.address = std::strcmp(args[++i], "wrap") == 0 ? TextureAddress::Wrap : TextureAddress::Clamp;
+        } else if (arg == "--pixel-format" && hasValue) {
+            options.pipeline.format = std::strcmp(args[++i], "abgr") == 0 ? PixelFormat::ABGR8888 : PixelFormat::ARGB8888;
+        } else {
+            std::cerr << "Usage: " << args[0] << " [--frames N] [--warmup N] [--threads N] [--format csv|json] [--mesh quad|plane:N|file.obj] [--texture path] [--simd scalar|sse2|avx2] [--subdivision 8,16,32] [--filter nearest|bilinear] [--address clamp|wrap] [--pixel-format argb|abgr]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void printCsv(const Options& options, const std::vector<ScenarioResult>& results) {
+    std::cout << "mesh,path,mode,subdivision,filter,address,simd,threads,frames,pixels_per_frame,ns_per_pixel,mpixels_per_s,texel_error_max,texel_error_mean,frame_p50_ms,frame_p90_ms,frame_p99_ms,frame_max_ms";
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; ++stage)
+        std::cout << "," << profileStageName(static_cast<ProfileStage>(stage)) << "_ns";
+    std::cout << "\n";
+    for (const ScenarioResult& result : results) {
+        std::cout << options.meshName << "," << result.path << "," << result.mode << "," << result.subdivisionStep << "," << textureFilterName(options.pipeline.filter) << "," << textureAddressName(options.pipeline.address) << "," << simdLevelName(options.simdLevel) << "," << options.threads << "," << result.frames
+                  << "," << result.pixelsPerFrame << "," << result.nsPerPixel << "," << result.megapixelsPerSecond
+                  << "," << result.texelErrorMax << "," << result.texelErrorMean;
+        for (double milliseconds : result.frameMilliseconds)
+            std::cout << "," << milliseconds;
+        for (double nanoseconds : result.stageNanoseconds)
+            std::cout << "," << nanoseconds;
+        std::cout << "\n";
+    }
+}
+
+void printJson(const Options& options, const std::vector<ScenarioResult>& results) {
+    std::cout << "{\n  \"mesh\": \"" << options.meshName << "\",\n  \"filter\": \"" << textureFilterName(options.pipeline.filter)
+              << "\",\n  \"address\": \"" << textureAddressName(options.pipeline.address) << "\",\n  \"simd\": \"" << simdLevelName(options.simdLevel) << "\",\n  \"threads\": " << options.threads << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult& result = results[i];
+        std::cout << "    {\"path\": \"" << result.path << "\", \"mode\": \"" << result.mode << "\", \"subdivision\": " << result.subdivisionStep << ", \"frames\": " << result.frames
+                  << ", \"pixels_per_frame\": " << result.pixelsPerFrame << ", \"ns_per_pixel\": " << result.nsPerPixel
+                  << ", \"mpixels_per_s\": " << result.megapixelsPerSecond
+                  << ", \"texel_error\": {\"max\": " << result.texelErrorMax << ", \"mean\": " << result.texelErrorMean << "}"
+                  << ", \"frame_ms\": {\"p50\": " << result.frameMilliseconds[0] << ", \"p90\": " << result.frameMilliseconds[1]
+                  << ", \"p99\": " << result.frameMilliseconds[2] << ", \"max\": " << result.frameMilliseconds[3] << "}, \"stage_ns\": {";
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; ++stage)
+            std::cout << (stage ? ", " : "") << "\"" << profileStageName(static_cast<ProfileStage>(stage)) << "\": " << result.stageNanoseconds[stage];
+        std::cout << "}}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char* args[]) {
+    Options options;
+    if (!parseOptions(argc, args, options))
+        return -1;
+
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
+        return -1;
+    }
+    if (!(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
+        std::cerr << "SDL_image initialization failed: " << IMG_GetError() << std::endl;
+        SDL_Quit();
+        return -1;
+    }
+
+    Mesh mesh;
+    if (!loadSceneMesh(options.meshName, mesh)) {
+        IMG_Quit();
+        SDL_Quit();
+        return -1;
+    }
+    GeometryPipeline geometry;
+
+    // Goes through the texture cache like the viewer, but waits for the load
+    TextureManager textures;
+    textures.request("benchmark", options.texturePath);
+    const Texture* loadedTexture = textures.wait("benchmark");
+    if (!loadedTexture) {
+        IMG_Quit();
+        SDL_Quit();
+        return -1;
+    }
+    const Texture& texture = *loadedTexture;
+
+    // Present through a hidden window when the video driver offers one,
+    // otherwise time a copy of the frame as the stand-in for the upload
+    SDL_Window* window = SDL_CreateWindow("Benchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+    FramebufferPresenter presenter;
+    Framebuffer framebuffer(SCREEN_WIDTH, SCREEN_HEIGHT, options.pipeline.format);
+    Framebuffer presented(SCREEN_WIDTH, SCREEN_HEIGHT, options.pipeline.format);
+    bool windowed = renderer && presenter.create(renderer, framebuffer);
+    if (!windowed)
+        std::cerr << "No renderer available (" << SDL_GetError() << "), timing a memory copy as present" << std::endl;
+
+    std::unique_ptr<ThreadPool> threadPool;
+    if (options.threads > 1)
+        threadPool = std::make_unique<ThreadPool>(options.threads);
+    TileRenderer tileRenderer(SCREEN_WIDTH, SCREEN_HEIGHT, threadPool.get());
+    glm::mat4 projection = sceneProjection(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    // Affine, exact perspective, then subdivided at every requested step
+    std::vector<PixelPipelineState> pipelines;
+    for (MappingMode mode : {MappingMode::Affine, MappingMode::Perspective}) {
+        pipelines.push_back(options.pipeline);
+        pipelines.back().mapping = mode;
+    }
+    for (int step : options.subdivisionSteps) {
+        pipelines.push_back(options.pipeline);
+        pipelines.back().mapping = MappingMode::Subdivided;
+        pipelines.back().subdivisionStep = step;
+    }
+
+    std::vector<ScenarioResult> results;
+    for (const CameraPath& path : CAMERA_PATHS) {
+        for (const PixelPipelineState& pipeline : pipelines) {
+            SpanShader shader = selectSpanShader(pipeline, options.simdLevel);
+            auto drawFrame = [&](int frame, FrameProfile* profile) {
+                tileRenderer.beginFrame();
+                glm::mat4 modelViewProjection = sceneModelViewProjection(projection, viewAt(path, std::max(frame, 0), options.frames));
+                submitMesh(geometry, mesh, modelViewProjection, SCREEN_WIDTH, SCREEN_HEIGHT, pipeline.mapping, shader, texture, tileRenderer, profile);
+                int64_t renderStart = profileNow();
+                tileRenderer.render(framebuffer, packColor(framebuffer.format, 0, 0, 0), profile);
+                int64_t presentStart = profileNow();
+                if (windowed)
+                    presenter.present(framebuffer);
+                else
+                    std::memcpy(presented.pixels.data(), framebuffer.pixels.data(), framebuffer.pixels.size() * sizeof(Uint32));
+                if (profile)
+                    profile->add(ProfileStage::Present, profileNow() - presentStart);
+                return presentStart - renderStart;
+            };
+
+            // Timed pass: exactly what the viewer runs, with no profile
+            std::vector<int64_t> frameTimes;
+            int64_t renderNanoseconds = 0;
+            for (int frame = -options.warmupFrames; frame < options.frames; ++frame) {
+                int64_t frameStart = profileNow();
+                int64_t rendered = drawFrame(frame, nullptr);
+                int64_t frameEnd = profileNow();
+                if (frame < 0)
+                    continue;
+                frameTimes.push_back(frameEnd - frameStart);
+                renderNanoseconds += rendered;
+            }
+
+            // Profiled pass over the same frames for the stage split and the
+            // covered pixels. The profiled renderer lists coverage before
+            // shading, so its times are not used for throughput.
+            FrameProfile total;
+            MappingError error;
+            for (int frame = 0; frame < options.frames; ++frame) {
+                FrameProfile profile;
+                drawFrame(frame, &profile);
+                for (int stage = 0; stage < PROFILE_STAGE_COUNT; ++stage)
+                    total.stageNanoseconds[stage] += profile.stageNanoseconds[stage];
+                total.coveredPixels += profile.coveredPixels;
+                // Off the clock, from the triangles just drawn
+                measureMappingError(tileRenderer, pipeline, error);
+            }
+
+            ScenarioResult result;
+            result.path = path.name;
+            result.mode = mappingModeName(pipeline.mapping);
+            if (pipeline.mapping == MappingMode::Subdivided)
+                result.subdivisionStep = pipeline.subdivisionStep;
+            result.frames = options.frames;
+
+            std::sort(frameTimes.begin(), frameTimes.end());
+            result.frameMilliseconds[0] = percentile(frameTimes, 0.50) / 1e6;
+            result.frameMilliseconds[1] = percentile(frameTimes, 0.90) / 1e6;
+            result.frameMilliseconds[2] = percentile(frameTimes, 0.99) / 1e6;
+            result.frameMilliseconds[3] = static_cast<double>(frameTimes.back()) / 1e6;
+
+            result.pixelsPerFrame = static_cast<double>(total.coveredPixels) / options.frames;
+            // Throughput of coverage and shading alone: transform, setup and
+            // the full-screen present would swamp small triangles
+            if (total.coveredPixels > 0 && renderNanoseconds > 0) {
+                result.nsPerPixel = static_cast<double>(renderNanoseconds) / static_cast<double>(total.coveredPixels);
+                result.megapixelsPerSecond = static_cast<double>(total.coveredPixels) / (static_cast<double>(renderNanoseconds) / 1e9) / 1e6;
+            }
+            for (int stage = 0; stage < PROFILE_STAGE_COUNT; ++stage)
+                result.stageNanoseconds[stage] = static_cast<double>(total.stageNanoseconds[stage]) / options.frames;
+            result.texelErrorMax = error.max;
+            if (error.pixels > 0)
+                result.texelErrorMean = error.sum / static_cast<double>(error.pixels);
+            results.push_back(result);
+        }
+    }
+
+    if (options.json)
+        printJson(options, results);
+    else
+        printCsv(options, results);
+
+    presenter.destroy();
+    if (renderer)
+        SDL_DestroyRenderer(renderer);
+    if (window)
+        SDL_DestroyWindow(window);
+    IMG_Quit();
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class ProfileStage {
+    Transform,
+    Setup,
+    Coverage,
+    Shading,
+    Present,
+    Count
+};
+
+const int PROFILE_STAGE_COUNT = static_cast<int>(ProfileStage::Count);
+
+// Time spent in each stage of one frame. Coverage and shading run on the
+// tile workers, so with several threads they add up CPU time, not wall time.
+struct FrameProfile {
+    int64_t stageNanoseconds[PROFILE_STAGE_COUNT] = {};
+    int64_t coveredPixels = 0;
+
+    void add(ProfileStage stage, int64_t nanoseconds) { stageNanoseconds[static_cast<int>(stage)] += nanoseconds; }
+};
+
+inline int64_t profileNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline const char* profileStageName(ProfileStage stage) {
+    switch (stage) {
+        case ProfileStage::Transform:
+            return "transform";
+        case ProfileStage::Setup:
+            return "setup";
+        case ProfileStage::Coverage:
+            return "coverage";
+        case ProfileStage::Shading:
+            return "shading";
+        case ProfileStage::Present:
+            return "present";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SDL.h>
+#include <utility>
+#include <vector>
+
+// Byte order of the packed 32-bit framebuffer pixels
+enum class PixelFormat {
+    ARGB8888,
+    ABGR8888
+};
+
+Uint32 sdlPixelFormat(PixelFormat format);
+
+// CPU colour buffer written directly by the rasterizer. Pixels are packed
+// 32-bit values, row-major with no padding between rows.
+struct Framebuffer {
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PixelFormat::ARGB8888;
+    std::vector<Uint32> pixels;
+
+    Framebuffer(int width, int height, PixelFormat format = PixelFormat::ARGB8888);
+
+    Uint32* row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+    const Uint32* row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+    int pitch() const { return width * static_cast<int>(sizeof(Uint32)); }
+
+    void clear(Uint32 color);
+};
+
+// Uploads a framebuffer to a window once per frame through a streaming
+// texture. Headless runs render into the Framebuffer and never create one.
+class FramebufferPresenter {
+public:
+    FramebufferPresenter() = default;
+    FramebufferPresenter(const FramebufferPresenter&) = delete;
+    FramebufferPresenter& operator=(const FramebufferPresenter&) = delete;
+    ~FramebufferPresenter();
+
+    bool create(SDL_Renderer* renderer, const Framebuffer& framebuffer);
+    void present(const Framebuffer& framebuffer);
+    // Must run before the renderer that owns the texture is destroyed
+    void destroy();
+
+private:
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+};
+
+inline Uint32 packColor(PixelFormat format, Uint8 r, Uint8 g, Uint8 b) {
+    if (format == PixelFormat::ABGR8888)
+        std::swap(r, b);
+    return 0xFF000000u | (static_cast<Uint32>(r) << 16) | (static_cast<Uint32>(g) << 8) | b;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "rasterizer.h"
+
+struct ScreenTriangle {
+    RasterVertex vertices[3];
+};
+
+// Turns an indexed mesh into the list of screen-space triangles the
+// rasterizer consumes: batched clip-space transform of the whole vertex
+// buffer, rejection of triangles outside the view volume, homogeneous
+// clipping against the near plane (and a wide guard band, so projected
+// coordinates stay inside the rasterizer's fixed-point range) and
+// back-face culling. Scratch buffers are kept between frames.
+class GeometryPipeline {
+public:
+    // Counter-clockwise triangles in normalized device coordinates face the viewer
+    const std::vector<ScreenTriangle>& process(const Mesh& mesh, const glm::mat4& modelViewProjection, int width, int height);
+
+private:
+    struct ClipVertex {
+        float x, y, z, w;
+        float s, t;
+    };
+
+    void transformVertices(const Mesh& mesh, const glm::mat4& modelViewProjection);
+    static int clipPolygon(int plane, ClipVertex* polygon, int count);
+    void emitPolygon(const ClipVertex* polygon, int count, bool cullBackFaces, int width, int height);
+
+    // Clip-space vertex buffer, one array per component
+    std::vector<float> clipX, clipY, clipZ, clipW;
+    std::vector<uint16_t> outcodes;
+    std::vector<ScreenTriangle> triangles;
+};
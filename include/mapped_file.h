@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SDL.h>
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The pages come straight from the
+// OS file cache, so opening costs neither a read nor a copy.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Returns false and leaves the mapping closed on failure; SDL_GetError()
+    // has the reason
+    bool open(const std::string& path);
+    void close();
+
+    const Uint8* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const Uint8* bytes = nullptr;
+    size_t length = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+// Indexed triangle mesh with its vertex attributes stored as separate
+// arrays, so the geometry stage can transform the whole buffer in one pass
+struct Mesh {
+    std::vector<float> x, y, z;       // object-space positions
+    std::vector<float> s, t;          // texture coordinates, t = 0 at the top row
+    std::vector<Uint32> indices;      // three per triangle
+    bool doubleSided = false;         // skip back-face culling
+
+    int vertexCount() const { return static_cast<int>(x.size()); }
+    int triangleCount() const { return static_cast<int>(indices.size() / 3); }
+
+    void addVertex(float px, float py, float pz, float ps, float pt);
+    void addTriangle(Uint32 a, Uint32 b, Uint32 c);
+};
+
+// The original 2x2 square in the z = 0 plane, visible from both sides
+Mesh makeQuadMesh();
+
+// The same square split into subdivisions x subdivisions quads, facing +z
+Mesh makeSubdividedPlane(int subdivisions);
+
+// Reads positions, texture coordinates and faces from a Wavefront OBJ file.
+// Polygons are split into fans. Returns false and prints the reason on error.
+bool loadObjMesh(const std::string& path, Mesh& mesh);
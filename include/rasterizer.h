@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+struct Point {
+    float x, y;
+};
+
+struct TexCoord {
+    float s, t;
+};
+
+// Triangle corner after projection: screen position in pixels plus the
+// attributes interpolated across the face
+struct RasterVertex {
+    Point position;
+    float w;             // clip-space w, used for perspective correction
+    TexCoord texCoord;
+};
+
+// Pixel rectangle, half-open on the right and bottom
+struct ClipRect {
+    int x0, y0, x1, y1;
+};
+
+// Attribute that varies linearly in screen space, anchored at the centre of
+// the first pixel of the triangle's bounding box to keep float precision
+struct AttributePlane {
+    float base, dx, dy;
+};
+
+// Fixed-point edge function: value at pixel (x, y) is c + a * x + b * y, with
+// the fill-rule bias already folded into c so a pixel is covered when >= 0
+struct EdgeFunction {
+    int64_t c, a, b;
+};
+
+struct TriangleSetup {
+    EdgeFunction edges[3];
+    ClipRect bounds;              // covered pixel bounds, already clipped
+    AttributePlane s, t;          // affine texture coordinates
+    AttributePlane q, sq, tq;     // 1/w, s/w and t/w for perspective correction
+};
+
+// Sub-pixel precision of the snapped vertex positions
+const int SUBPIXEL_BITS = 4;
+const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+// Does the per-triangle work once: snaps the vertices, builds the edge
+// functions and attribute gradients. Returns false for triangles that cover
+// no pixels of the clip rectangle.
+bool setupTriangle(const RasterVertex& v1, const RasterVertex& v2, const RasterVertex& v3, const ClipRect& clip, TriangleSetup& setup);
+
+// Solves the covered pixel range [x0, x1) of row y from the edge values at the
+// start of the row. Returns false when the row is empty.
+bool edgeSpan(const TriangleSetup& setup, const int64_t rowEdge[3], int& x0, int& x1);
+
+// Row term first, then the x term: the span shaders hoist the row term out of
+// the pixel loop and must produce bit-identical results
+inline float evaluatePlane(const AttributePlane& plane, int x, int y, const ClipRect& origin) {
+    float rowValue = plane.base + plane.dy * static_cast<float>(y - origin.y0);
+    return rowValue + plane.dx * static_cast<float>(x - origin.x0);
+}
+
+// Walks the rows of the triangle that fall inside clip and calls
+// shadeSpan(y, x0, x1) for every non-empty covered span [x0, x1)
+template <typename SpanFunction>
+void rasterizeTriangle(const TriangleSetup& setup, const ClipRect& clip, SpanFunction&& shadeSpan) {
+    int yStart = std::max(setup.bounds.y0, clip.y0);
+    int yEnd = std::min(setup.bounds.y1, clip.y1);
+    int xMin = std::max(setup.bounds.x0, clip.x0);
+    int xMax = std::min(setup.bounds.x1, clip.x1);
+    if (yStart >= yEnd || xMin >= xMax)
+        return;
+
+    // Edge values at x = 0 of the first row, then stepped by b per row
+    int64_t rowEdge[3];
+    for (int i = 0; i < 3; ++i)
+        rowEdge[i] = setup.edges[i].c + setup.edges[i].b * yStart;
+
+    for (int y = yStart; y < yEnd; ++y) {
+        int x0, x1;
+        if (edgeSpan(setup, rowEdge, x0, x1)) {
+            x0 = std::max(x0, xMin);
+            x1 = std::min(x1, xMax);
+            if (x0 < x1)
+                shadeSpan(y, x0, x1);
+        }
+        for (int i = 0; i < 3; ++i)
+            rowEdge[i] += setup.edges[i].b;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <string>
+#include "frame_profile.h"
+#include "geometry.h"
+#include "mesh.h"
+#include "span_shader.h"
+#include "tile_renderer.h"
+
+// Viewpoint of the spinning textured mesh shown by the viewer and the
+// benchmark
+struct SceneView {
+    glm::vec3 cameraPosition;
+    float rotationAngle;
+    float cameraRoll = 0.0f;    // radians about the view direction
+};
+
+// Rotation applied to the mesh every frame: one turn per 120 frames
+const float SCENE_ANGULAR_SPEED = glm::two_pi<float>() / 120.0f;
+
+glm::mat4 sceneProjection(int width, int height);
+glm::mat4 sceneModelViewProjection(const glm::mat4& projection, const SceneView& view);
+
+// Builds the mesh named on the command line: "quad" (the original square),
+// "plane:N" (the square split into N x N quads) or the path of an OBJ file
+bool loadSceneMesh(const std::string& name, Mesh& mesh);
+
+// Runs the mesh through the geometry stage, sets up the visible triangles
+// and adds them to the renderer. Geometry time is reported as the transform
+// stage and triangle setup as the setup stage when a profile is given.
+void submitMesh(GeometryPipeline& geometry, const Mesh& mesh, const glm::mat4& modelViewProjection, int width, int height, MappingMode mode, SpanShader shader, const Texture& texture, TileRenderer& renderer, FrameProfile* profile = nullptr);
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include "span_shader.h"
+
+// Building blocks of the span shader variants. The scalar helpers define the
+// exact result of every variant: the SIMD kernels repeat the same float
+// operations in the same order, including MAXPS/MINPS NaN behaviour.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SPAN_SHADER_X86 1
+#endif
+
+const int MAPPING_MODE_COUNT = 3;
+const int TEXTURE_FILTER_COUNT = 2;
+const int TEXTURE_ADDRESS_COUNT = 2;
+const int PIXEL_FORMAT_COUNT = 2;
+const int SPAN_SHADER_VARIANT_COUNT = MAPPING_MODE_COUNT * SUBDIVISION_STEP_COUNT * TEXTURE_FILTER_COUNT * TEXTURE_ADDRESS_COUNT * PIXEL_FORMAT_COUNT;
+
+inline int spanShaderVariant(const PixelPipelineState& state) {
+    int index = static_cast<int>(state.mapping);
+    index = index * SUBDIVISION_STEP_COUNT + subdivisionStepIndex(state.subdivisionStep);
+    index = index * TEXTURE_FILTER_COUNT + static_cast<int>(state.filter);
+    index = index * TEXTURE_ADDRESS_COUNT + static_cast<int>(state.address);
+    return index * PIXEL_FORMAT_COUNT + static_cast<int>(state.format);
+}
+
+// Inverse of spanShaderVariant() at compile time
+template <size_t Index>
+struct SpanShaderVariant {
+    static constexpr PixelFormat format = static_cast<PixelFormat>(Index % PIXEL_FORMAT_COUNT);
+    static constexpr TextureAddress address = static_cast<TextureAddress>(Index / PIXEL_FORMAT_COUNT % TEXTURE_ADDRESS_COUNT);
+    static constexpr TextureFilter filter = static_cast<TextureFilter>(Index / (PIXEL_FORMAT_COUNT * TEXTURE_ADDRESS_COUNT) % TEXTURE_FILTER_COUNT);
+    static constexpr int subdivisionStep = SPAN_SUBDIVISION_STEPS[Index / (PIXEL_FORMAT_COUNT * TEXTURE_ADDRESS_COUNT * TEXTURE_FILTER_COUNT) % SUBDIVISION_STEP_COUNT];
+    static constexpr MappingMode mapping = static_cast<MappingMode>(Index / (PIXEL_FORMAT_COUNT * TEXTURE_ADDRESS_COUNT * TEXTURE_FILTER_COUNT * SUBDIVISION_STEP_COUNT));
+};
+
+using SpanShaderTable = std::array<SpanShader, SPAN_SHADER_VARIANT_COUNT>;
+
+// Builds a table from Family::variant<Index>() for every variant index
+template <typename Family, size_t... Index>
+constexpr SpanShaderTable makeSpanShaderTable(std::index_sequence<Index...>) {
+    return {{Family::template variant<Index>()...}};
+}
+
+inline float maxps(float a, float b) {
+    return a > b ? a : b;
+}
+
+inline float minps(float a, float b) {
+    return a < b ? a : b;
+}
+
+// Wrapped coordinates are clamped to this range first so the truncating
+// floor below cannot overflow
+const float WRAP_LIMIT = 4194304.0f;
+
+// floor() from truncation, since SSE2 has no rounding instruction
+inline float floorTruncated(float value) {
+    float truncated = static_cast<float>(static_cast<int>(value));
+    return truncated > value ? truncated - 1.0f : truncated;
+}
+
+template <MappingMode Mapping>
+inline TexCoord mapTexCoord(const TriangleSetup& setup, int x, int y) {
+    if constexpr (Mapping == MappingMode::Affine)
+        return affineTextureMapping(setup, x, y);
+    else
+        return perspectivelyCorrectTextureMapping(setup, x, y);
+}
+
+// Nearest texel column or row for coordinate s across size texels
+template <TextureAddress Address>
+inline int nearestTexel(float s, float size) {
+    if constexpr (Address == TextureAddress::Clamp) {
+        return static_cast<int>(minps(maxps(s * size, 0.0f), size - 1.0f));
+    } else {
+        float clamped = minps(maxps(s, -WRAP_LIMIT), WRAP_LIMIT);
+        float fraction = clamped - floorTruncated(clamped);
+        return static_cast<int>(minps(fraction * size, size - 1.0f));
+    }
+}
+
+// The two texels a bilinear tap blends and the 8-bit weight of the second
+template <TextureAddress Address>
+inline void bilinearTexels(float s, int size, int& first, int& second, int& weight) {
+    float u = minps(maxps(s * static_cast<float>(size) - 0.5f, -WRAP_LIMIT), WRAP_LIMIT);
+    float base = floorTruncated(u);
+    weight = static_cast<int>((u - base) * 256.0f);
+    int texel = static_cast<int>(base);
+    if constexpr (Address == TextureAddress::Clamp) {
+        first = std::min(std::max(texel, 0), size - 1);
+        second = std::min(std::max(texel + 1, 0), size - 1);
+    } else {
+        first = texel % size;
+        if (first < 0)
+            first += size;
+        second = first + 1 == size ? 0 : first + 1;
+    }
+}
+
+// Blends two ARGB colours two channels at a time
+inline Uint32 lerpColor(Uint32 a, Uint32 b, int weight) {
+    Uint32 inverse = static_cast<Uint32>(256 - weight);
+    Uint32 forward = static_cast<Uint32>(weight);
+    Uint32 rb = (((a & 0x00FF00FFu) * inverse + (b & 0x00FF00FFu) * forward) >> 8) & 0x00FF00FFu;
+    Uint32 ag = ((((a >> 8) & 0x00FF00FFu) * inverse + ((b >> 8) & 0x00FF00FFu) * forward) >> 8) & 0x00FF00FFu;
+    return rb | (ag << 8);
+}
+
+template <TextureFilter Filter, TextureAddress Address>
+inline Uint32 sampleTexture(const TextureView& texture, const TexCoord& texCoord) {
+    if constexpr (Filter == TextureFilter::Nearest) {
+        int x = nearestTexel<Address>(texCoord.s, static_cast<float>(texture.width));
+        int y = nearestTexel<Address>(texCoord.t, static_cast<float>(texture.height));
+        return texture.texels[tiledTexelIndex(x, y, texture.blocksPerRow)];
+    } else {
+        int x0, x1, weightX, y0, y1, weightY;
+        bilinearTexels<Address>(texCoord.s, texture.width, x0, x1, weightX);
+        bilinearTexels<Address>(texCoord.t, texture.height, y0, y1, weightY);
+        Uint32 top = lerpColor(texture.texels[tiledTexelIndex(x0, y0, texture.blocksPerRow)], texture.texels[tiledTexelIndex(x1, y0, texture.blocksPerRow)], weightX);
+        Uint32 bottom = lerpColor(texture.texels[tiledTexelIndex(x0, y1, texture.blocksPerRow)], texture.texels[tiledTexelIndex(x1, y1, texture.blocksPerRow)], weightX);
+        return lerpColor(top, bottom, weightY);
+    }
+}
+
+// Converts an ARGB texel to an opaque framebuffer pixel
+template <PixelFormat Format>
+inline Uint32 framebufferColor(Uint32 argb) {
+    if constexpr (Format == PixelFormat::ARGB8888)
+        return argb | 0xFF000000u;
+    else
+        return (argb & 0x0000FF00u) | ((argb >> 16) & 0xFFu) | ((argb & 0xFFu) << 16) | 0xFF000000u;
+}
+
+// One piece of a subdivided span: pixel x in [x0, x1) maps to
+// start + slope * (x - x0). start is exact, and the slope leads to the exact
+// coordinates at x1, or at the last pixel for the final piece.
+struct SpanSegment {
+    int x0, x1;
+    TexCoord start, slope, end;
+};
+
+// Pixel whose exact coordinates end the segment starting at x
+inline int segmentAnchor(int x, int spanEnd, int step) {
+    return std::min(x + step, spanEnd - 1);
+}
+
+// The segment starting at x, given the exact coordinates at x and at its anchor
+inline SpanSegment spanSegment(int x, int spanEnd, int step, const TexCoord& start, const TexCoord& end) {
+    SpanSegment segment;
+    segment.x0 = x;
+    segment.x1 = std::min(x + step, spanEnd);
+    segment.start = start;
+    segment.end = end;
+    // Only the last segment of a span is shorter than step, so with a
+    // compile-time step every other segment multiplies by a constant
+    int length = segmentAnchor(x, spanEnd, step) - x;
+    float inverseLength = length == step ? 1.0f / static_cast<float>(step) : length > 0 ? 1.0f / static_cast<float>(length) : 0.0f;
+    segment.slope = {(end.s - start.s) * inverseLength, (end.t - start.t) * inverseLength};
+    return segment;
+}
+
+// Divides once per segment: the end of one segment is the start of the next
+inline SpanSegment subdivideSpan(const TriangleSetup& setup, int y, int x, int spanEnd, int step, const TexCoord& start) {
+    return spanSegment(x, spanEnd, step, start, perspectivelyCorrectTextureMapping(setup, segmentAnchor(x, spanEnd, step), y));
+}
+
+inline TexCoord segmentTexCoord(const SpanSegment& segment, int x) {
+    float fx = static_cast<float>(x - segment.x0);
+    return {segment.start.s + segment.slope.s * fx, segment.start.t + segment.slope.t * fx};
+}
+
+template <MappingMode Mapping, TextureFilter Filter, TextureAddress Address, PixelFormat Format>
+void shadeSpanScalar(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    for (int x = x0; x < x1; ++x)
+        row[x] = framebufferColor<Format>(sampleTexture<Filter, Address>(texture, mapTexCoord<Mapping>(setup, x, y)));
+}
+
+template <TextureFilter Filter, TextureAddress Address, PixelFormat Format>
+inline void shadeSegmentScalar(const SpanSegment& segment, const TextureView& texture, int x0, Uint32* row) {
+    for (int x = x0; x < segment.x1; ++x)
+        row[x] = framebufferColor<Format>(sampleTexture<Filter, Address>(texture, segmentTexCoord(segment, x)));
+}
+
+template <int Step, TextureFilter Filter, TextureAddress Address, PixelFormat Format>
+void shadeSubdividedSpanScalar(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    TexCoord start = perspectivelyCorrectTextureMapping(setup, x0, y);
+    for (int x = x0; x < x1;) {
+        SpanSegment segment = subdivideSpan(setup, y, x, x1, Step, start);
+        shadeSegmentScalar<Filter, Address, Format>(segment, texture, x, row);
+        start = segment.end;
+        x = segment.x1;
+    }
+}
+
+struct ScalarSpanShaders {
+    template <size_t Index>
+    static constexpr SpanShader variant() {
+        using Variant = SpanShaderVariant<Index>;
+        if constexpr (Variant::mapping == MappingMode::Subdivided)
+            return &shadeSubdividedSpanScalar<Variant::subdivisionStep, Variant::filter, Variant::address, Variant::format>;
+        else
+            return &shadeSpanScalar<Variant::mapping, Variant::filter, Variant::address, Variant::format>;
+    }
+};
+
+#if SPAN_SHADER_X86
+// Vector tables; bilinear variants and the tails of every span use the
+// scalar shaders
+const SpanShaderTable& sse2SpanShaders();
+const SpanShaderTable& avx2SpanShaders();
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SDL.h>
+#include <iterator>
+#include "framebuffer.h"
+#include "rasterizer.h"
+#include "texture.h"
+
+enum class MappingMode {
+    Affine,
+    Perspective,
+    Subdivided      // exact every subdivisionStep pixels, affine in between
+};
+
+enum class TextureFilter {
+    Nearest,
+    Bilinear
+};
+
+// How texture coordinates outside [0, 1) are brought back onto the texture
+enum class TextureAddress {
+    Clamp,
+    Wrap
+};
+
+// Pixels between exact divides that subdivided mapping is compiled for
+constexpr int SPAN_SUBDIVISION_STEPS[] = {8, 16, 32};
+const int SUBDIVISION_STEP_COUNT = static_cast<int>(std::size(SPAN_SUBDIVISION_STEPS));
+
+// Index into SPAN_SUBDIVISION_STEPS, rounding other steps up to the next one
+inline int subdivisionStepIndex(int step) {
+    int index = 0;
+    while (index + 1 < SUBDIVISION_STEP_COUNT && SPAN_SUBDIVISION_STEPS[index] < step)
+        ++index;
+    return index;
+}
+
+// Everything that selects a span shader variant
+struct PixelPipelineState {
+    MappingMode mapping = MappingMode::Affine;
+    int subdivisionStep = 16;   // one of SPAN_SUBDIVISION_STEPS
+    TextureFilter filter = TextureFilter::Nearest;
+    TextureAddress address = TextureAddress::Clamp;
+    PixelFormat format = PixelFormat::ARGB8888;
+};
+
+inline TexCoord affineTextureMapping(const TriangleSetup& setup, int x, int y) {
+    // Texture coordinates are linear in screen space
+    float s = evaluatePlane(setup.s, x, y, setup.bounds);
+    float t = evaluatePlane(setup.t, x, y, setup.bounds);
+
+    return {s, t};
+}
+
+inline TexCoord perspectivelyCorrectTextureMapping(const TriangleSetup& setup, int x, int y) {
+    // s/w, t/w and 1/w are linear in screen space; one divide recovers s and t
+    float w = 1.0f / evaluatePlane(setup.q, x, y, setup.bounds);
+    float s = evaluatePlane(setup.sq, x, y, setup.bounds) * w;
+    float t = evaluatePlane(setup.tq, x, y, setup.bounds) * w;
+
+    return {s, t};
+}
+
+// Texture coordinates of the pixels [x0, x1) of row y exactly as the span
+// shaders compute them. Subdivided mapping divides at x0 and every
+// subdivisionStep pixels after it, and at the last pixel.
+void mapSpanTexCoords(const TriangleSetup& setup, MappingMode mode, int subdivisionStep, int y, int x0, int x1, TexCoord* texCoords);
+
+// Nearest mip level for the pixels [x0, x1) of row y, chosen from the
+// screen-space derivatives of the texel coordinates at their centre. An
+// affine triangle gets one level throughout; perspective follows the depth.
+int selectMipLevel(const TriangleSetup& setup, MappingMode mode, const Texture& texture, int y, int x0, int x1);
+
+// Shades the covered pixels [x0, x1) of row y from one mip level
+using SpanShader = void (*)(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row);
+
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Widest instruction set supported by both the build and the running CPU
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+const char* mappingModeName(MappingMode mode);
+const char* textureFilterName(TextureFilter filter);
+const char* textureAddressName(TextureAddress address);
+
+// Shader compiled for exactly this state, so its pixel loop holds no mode
+// branches. Look it up once per frame or per triangle. Every SIMD level
+// produces bit-identical output to the scalar shaders.
+SpanShader selectSpanShader(const PixelPipelineState& state, SimdLevel level);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SDL.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+// Texels are stored in 4x4 blocks, so one 64-byte cache line holds a block
+// and walking the texture at any angle touches few lines
+const int TEXTURE_BLOCK_BITS = 2;
+const int TEXTURE_BLOCK_SIZE = 1 << TEXTURE_BLOCK_BITS;
+
+// Read-only view of one mip level
+struct TextureView {
+    const Uint32* texels;  // ARGB8888 in block order
+    int width, height;
+    int blocksPerRow;
+};
+
+inline int tiledTexelIndex(int x, int y, int blocksPerRow) {
+    int block = (y >> TEXTURE_BLOCK_BITS) * blocksPerRow + (x >> TEXTURE_BLOCK_BITS);
+    return (block << (2 * TEXTURE_BLOCK_BITS)) + ((y & (TEXTURE_BLOCK_SIZE - 1)) << TEXTURE_BLOCK_BITS) + (x & (TEXTURE_BLOCK_SIZE - 1));
+}
+
+// Texture converted once at load time: canonical ARGB8888 texels in block
+// order with a full mip chain down to 1x1
+class Texture {
+public:
+    // Converts any surface format SDL can read. Returns false and leaves the
+    // texture empty when the conversion fails; SDL_GetError() has the reason.
+    bool loadFromSurface(SDL_Surface* surface);
+
+    // Writes the texels and mip chain exactly as they sit in memory, stamped
+    // with the size and modification time of the image they came from
+    bool saveCache(const std::string& cachePath, const std::string& sourcePath) const;
+
+    // Maps a file written by saveCache() and reads the texels in place, with
+    // no decode or copy. Fails like loadFromSurface() when the file is
+    // missing, malformed, from another build or older than sourcePath.
+    bool loadFromCache(const std::string& cachePath, const std::string& sourcePath);
+
+    int levelCount() const { return static_cast<int>(levels.size()); }
+    const TextureView& level(int index) const { return levels[index]; }
+
+private:
+    struct AlignedDelete {
+        void operator()(Uint32* texels) const;
+    };
+
+    void reset();
+
+    std::vector<TextureView> levels;
+    std::unique_ptr<Uint32[], AlignedDelete> storage;   // converted in memory
+    MappedFile cache;                                   // or mapped from a cache file
+};
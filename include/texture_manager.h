@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "texture.h"
+
+const char* const TEXTURE_CACHE_SUFFIX = ".texcache";
+
+// Loads textures by name on a background thread so rendering never waits
+// for an image decode. The first load of an image decodes it, converts it
+// and writes the result to a cache file next to it (image path +
+// TEXTURE_CACHE_SUFFIX) after handing the texture over; later runs map that
+// file instead. Progress and errors are printed to stderr. Until a texture
+// is ready, get() returns a checkerboard placeholder.
+//
+// request(), get() and wait() are for one thread, the renderer.
+// A texture never changes once it is ready, so the renderer can keep
+// drawing with it while other textures load.
+class TextureManager {
+public:
+    TextureManager();
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+    // Finishes the load in progress, and its cache file, and drops the rest
+    // of the queue
+    ~TextureManager();
+
+    // Queues the image at path under name. Requesting a name again does
+    // nothing, so callers may request every frame.
+    void request(const std::string& name, const std::string& path);
+
+    // The texture once it has loaded, otherwise the placeholder
+    const Texture& get(const std::string& name) const;
+
+    // Blocks until name has loaded or failed. Returns nullptr for failed or
+    // unknown names; SDL has no error to report across threads, so the
+    // reason is printed by the loader.
+    const Texture* wait(const std::string& name);
+
+private:
+    enum class LoadState {
+        Queued,
+        Ready,
+        Failed
+    };
+
+    struct Entry {
+        std::string name;
+        std::string path;
+        Texture texture;
+        std::atomic<LoadState> state{LoadState::Queued};   // Ready publishes texture
+    };
+
+    void workerLoop();
+    bool load(Entry& entry, bool& decoded);
+    void writeCache(const Entry& entry);
+
+    Texture placeholderTexture;
+    std::map<std::string, std::unique_ptr<Entry>> entries;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable loaded;
+    std::deque<Entry*> queue;
+    bool stopping = false;
+    std::thread worker;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent workers that run batches of independent tasks. Each worker
+// starts on its own contiguous block of task indices and steals from the
+// other blocks once its own is exhausted. The calling thread takes part as
+// worker 0, so a pool of N threads starts N - 1 extra threads.
+class ThreadPool {
+public:
+    using Task = std::function<void(int task, int worker)>;
+
+    explicit ThreadPool(int threadCount);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    int threadCount() const { return static_cast<int>(queues.size()); }
+
+    // Runs task(i, worker) for every i in [0, taskCount) and returns when
+    // all of them have finished. Not re-entrant.
+    void run(int taskCount, const Task& task);
+
+private:
+    // Remaining task indices [next, end) owned by one worker. Owner and
+    // thieves both claim with fetch_add, so no lock is needed.
+    struct alignas(64) TaskQueue {
+        std::atomic<int> next{0};
+        int end = 0;
+    };
+
+    void workerLoop(int worker);
+    void drain(int worker);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const Task* currentTask = nullptr;
+    unsigned generation = 0;
+    int activeWorkers = 0;
+    bool stopping = false;
+};
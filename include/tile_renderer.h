@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include "frame_profile.h"
+#include "framebuffer.h"
+#include "rasterizer.h"
+#include "span_shader.h"
+#include "thread_pool.h"
+
+const int TILE_SIZE = 64;
+
+// Triangle ready to rasterize, with the shader and texture it is drawn with
+struct DrawTriangle {
+    TriangleSetup setup;
+    MappingMode mode;
+    SpanShader shader;
+    const Texture* texture;
+};
+
+// Collects a frame's triangles, bins them to the screen tiles they overlap
+// and shades the tiles in parallel. Every tile is owned by one task, so the
+// workers never write to the same pixels. Without a pool the triangles are
+// drawn in submission order over the whole screen, which is the reference
+// path; both paths produce identical images.
+class TileRenderer {
+public:
+    TileRenderer(int width, int height, ThreadPool* pool);
+
+    void beginFrame();
+    void addTriangle(const DrawTriangle& triangle);
+
+    // With a profile, coverage is computed into a span list before any
+    // shading so the two stages can be timed apart. The image is the same.
+    void render(Framebuffer& framebuffer, Uint32 clearColor, FrameProfile* profile = nullptr);
+
+    const std::vector<DrawTriangle>& frameTriangles() const { return triangles; }
+
+private:
+    struct CoveredSpan {
+        int triangle;
+        int y, x0, x1;
+    };
+
+    struct alignas(64) WorkerProfile {
+        int64_t coverageNanoseconds = 0;
+        int64_t shadingNanoseconds = 0;
+        int64_t coveredPixels = 0;
+        std::vector<CoveredSpan> spans;
+    };
+
+    void binTriangle(int index);
+    void renderTile(Framebuffer& framebuffer, Uint32 clearColor, int tile) const;
+    void renderTileProfiled(Framebuffer& framebuffer, Uint32 clearColor, const ClipRect& rect, const std::vector<int>& indices, WorkerProfile& profile) const;
+    void shadeSpan(Framebuffer& framebuffer, const DrawTriangle& triangle, int y, int x0, int x1) const;
+    ClipRect tileRect(int tile) const;
+
+    int width, height;
+    int tilesX, tilesY;
+    ThreadPool* pool;
+    std::vector<DrawTriangle> triangles;
+    std::vector<std::vector<int>> bins;   // triangle indices per tile, in submission order
+    std::vector<int> allTriangles;        // 0..n-1 for the profiled reference path
+    std::vector<WorkerProfile> workerProfiles;
+};
@@ -0,0 +1,42 @@
+#include "framebuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+Uint32 sdlPixelFormat(PixelFormat format) {
+    return format == PixelFormat::ABGR8888 ? SDL_PIXELFORMAT_ABGR8888 : SDL_PIXELFORMAT_ARGB8888;
+}
+
+Framebuffer::Framebuffer(int width, int height, PixelFormat format)
+    : width(width), height(height), format(format), pixels(static_cast<size_t>(width) * height) {}
+
+void Framebuffer::clear(Uint32 color) {
+    // A colour with four equal bytes (e.g. zero) can go straight to memset
+    Uint8 lowByte = color & 0xFF;
+    if (color == lowByte * 0x01010101u)
+        std::memset(pixels.data(), lowByte, pixels.size() * sizeof(Uint32));
+    else
+        std::fill(pixels.begin(), pixels.end(), color);
+}
+
+FramebufferPresenter::~FramebufferPresenter() {
+    destroy();
+}
+
+void FramebufferPresenter::destroy() {
+    if (texture)
+        SDL_DestroyTexture(texture);
+    texture = nullptr;
+}
+
+bool FramebufferPresenter::create(SDL_Renderer* renderer, const Framebuffer& framebuffer) {
+    this->renderer = renderer;
+    texture = SDL_CreateTexture(renderer, sdlPixelFormat(framebuffer.format), SDL_TEXTUREACCESS_STREAMING, framebuffer.width, framebuffer.height);
+    return texture != nullptr;
+}
+
+void FramebufferPresenter::present(const Framebuffer& framebuffer) {
+    SDL_UpdateTexture(texture, nullptr, framebuffer.pixels.data(), framebuffer.pitch());
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
@@ -0,0 +1,164 @@
+#include "geometry.h"
+
+#include <algorithm>
+
+namespace {
+
+// Projected coordinates beyond this many viewport half-widths are clipped
+// away before the divide. Keeps every vertex that reaches setupTriangle()
+// inside MAX_SNAP_COORDINATE (2^20 pixels, rasterizer.cpp) for viewports up
+// to about 8000 pixels across, so clipped triangles are never rejected there.
+const float GUARD_BAND = 256.0f;
+
+enum ClipPlane {
+    CLIP_NEAR = 1 << 0,
+    CLIP_FAR = 1 << 1,
+    CLIP_LEFT = 1 << 2,
+    CLIP_RIGHT = 1 << 3,
+    CLIP_BOTTOM = 1 << 4,
+    CLIP_TOP = 1 << 5,
+    GUARD_LEFT = 1 << 6,
+    GUARD_RIGHT = 1 << 7,
+    GUARD_BOTTOM = 1 << 8,
+    GUARD_TOP = 1 << 9,
+};
+
+// A triangle entirely outside one view volume plane is rejected; only the
+// near and guard-band planes ever cut a triangle
+const int REJECT_PLANES = CLIP_NEAR | CLIP_FAR | CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP;
+const int CLIP_PLANES[] = {CLIP_NEAR, GUARD_LEFT, GUARD_RIGHT, GUARD_BOTTOM, GUARD_TOP};
+
+// Clipping a convex polygon against one plane adds at most one vertex
+const int MAX_POLYGON = 3 + 5;
+
+int computeOutcode(float x, float y, float z, float w) {
+    int code = 0;
+    if (z < -w) code |= CLIP_NEAR;
+    if (z > w) code |= CLIP_FAR;
+    if (x < -w) code |= CLIP_LEFT;
+    if (x > w) code |= CLIP_RIGHT;
+    if (y < -w) code |= CLIP_BOTTOM;
+    if (y > w) code |= CLIP_TOP;
+    if (x < -GUARD_BAND * w) code |= GUARD_LEFT;
+    if (x > GUARD_BAND * w) code |= GUARD_RIGHT;
+    if (y < -GUARD_BAND * w) code |= GUARD_BOTTOM;
+    if (y > GUARD_BAND * w) code |= GUARD_TOP;
+    return code;
+}
+
+}
+
+const std::vector<ScreenTriangle>& GeometryPipeline::process(const Mesh& mesh, const glm::mat4& modelViewProjection, int width, int height) {
+    triangles.clear();
+    transformVertices(mesh, modelViewProjection);
+
+    bool cullBackFaces = !mesh.doubleSided;
+    size_t vertexCount = clipX.size();
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        Uint32 index[3] = {mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]};
+        if (index[0] >= vertexCount || index[1] >= vertexCount || index[2] >= vertexCount)
+            continue;
+
+        int codes[3] = {outcodes[index[0]], outcodes[index[1]], outcodes[index[2]]};
+        if (codes[0] & codes[1] & codes[2] & REJECT_PLANES)
+            continue;
+
+        ClipVertex polygon[MAX_POLYGON];
+        for (int k = 0; k < 3; ++k)
+            polygon[k] = {clipX[index[k]], clipY[index[k]], clipZ[index[k]], clipW[index[k]], mesh.s[index[k]], mesh.t[index[k]]};
+
+        int count = 3;
+        int crossed = codes[0] | codes[1] | codes[2];
+        for (int plane : CLIP_PLANES) {
+            if ((crossed & plane) && count >= 3)
+                count = clipPolygon(plane, polygon, count);
+        }
+        if (count >= 3)
+            emitPolygon(polygon, count, cullBackFaces, width, height);
+    }
+    return triangles;
+}
+
+void GeometryPipeline::transformVertices(const Mesh& mesh, const glm::mat4& m) {
+    size_t count = mesh.x.size();
+    clipX.resize(count);
+    clipY.resize(count);
+    clipZ.resize(count);
+    clipW.resize(count);
+    outcodes.resize(count);
+
+    // Plain loops over separate arrays so the compiler can vectorize them
+    const float* __restrict inX = mesh.x.data();
+    const float* __restrict inY = mesh.y.data();
+    const float* __restrict inZ = mesh.z.data();
+    float* __restrict outX = clipX.data();
+    float* __restrict outY = clipY.data();
+    float* __restrict outZ = clipZ.data();
+    float* __restrict outW = clipW.data();
+    for (size_t i = 0; i < count; ++i) {
+        float x = inX[i], y = inY[i], z = inZ[i];
+        outX[i] = m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0];
+        outY[i] = m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1];
+        outZ[i] = m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2];
+        outW[i] = m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3];
+    }
+    for (size_t i = 0; i < count; ++i)
+        outcodes[i] = static_cast<uint16_t>(computeOutcode(outX[i], outY[i], outZ[i], outW[i]));
+}
+
+int GeometryPipeline::clipPolygon(int plane, ClipVertex* polygon, int count) {
+    auto distance = [plane](const ClipVertex& v) {
+        switch (plane) {
+            case CLIP_NEAR: return v.z + v.w;
+            case GUARD_LEFT: return GUARD_BAND * v.w + v.x;
+            case GUARD_RIGHT: return GUARD_BAND * v.w - v.x;
+            case GUARD_BOTTOM: return GUARD_BAND * v.w + v.y;
+            default: return GUARD_BAND * v.w - v.y;
+        }
+    };
+
+    // Sutherland-Hodgman against a single plane; attributes are linear in clip space
+    ClipVertex clipped[MAX_POLYGON];
+    int clippedCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const ClipVertex& a = polygon[i];
+        const ClipVertex& b = polygon[(i + 1) % count];
+        float da = distance(a);
+        float db = distance(b);
+        if (da >= 0.0f)
+            clipped[clippedCount++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float f = da / (da - db);
+            clipped[clippedCount++] = {a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f, a.z + (b.z - a.z) * f, a.w + (b.w - a.w) * f,
+                                       a.s + (b.s - a.s) * f, a.t + (b.t - a.t) * f};
+        }
+    }
+    std::copy(clipped, clipped + clippedCount, polygon);
+    return clippedCount;
+}
+
+void GeometryPipeline::emitPolygon(const ClipVertex* polygon, int count, bool cullBackFaces, int width, int height) {
+    RasterVertex projected[MAX_POLYGON];
+    float ndcX[MAX_POLYGON], ndcY[MAX_POLYGON];
+    for (int i = 0; i < count; ++i) {
+        // Normalize the vertices and convert them to screen coordinates
+        ndcX[i] = polygon[i].x / polygon[i].w;
+        ndcY[i] = polygon[i].y / polygon[i].w;
+        projected[i].position = {(ndcX[i] + 1.0f) * width / 2.0f, (1.0f - ndcY[i]) * height / 2.0f};
+        // w values for perspective correction
+        projected[i].w = polygon[i].w;
+        projected[i].texCoord = {polygon[i].s, polygon[i].t};
+    }
+
+    // Twice the signed area, positive for counter-clockwise (front-facing) polygons
+    float area = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        int next = (i + 1) % count;
+        area += ndcX[i] * ndcY[next] - ndcX[next] * ndcY[i];
+    }
+    if (area == 0.0f || (cullBackFaces && area < 0.0f))
+        return;
+
+    for (int i = 2; i < count; ++i)
+        triangles.push_back({{projected[0], projected[i - 1], projected[i]}});
+}
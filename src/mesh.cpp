@@ -0,0 +1,147 @@
+#include "mesh.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <utility>
+
+void Mesh::addVertex(float px, float py, float pz, float ps, float pt) {
+    x.push_back(px);
+    y.push_back(py);
+    z.push_back(pz);
+    s.push_back(ps);
+    t.push_back(pt);
+}
+
+void Mesh::addTriangle(Uint32 a, Uint32 b, Uint32 c) {
+    indices.push_back(a);
+    indices.push_back(b);
+    indices.push_back(c);
+}
+
+Mesh makeQuadMesh() {
+    Mesh mesh;
+    mesh.addVertex(1.0f, -1.0f, 0.0f, 0.0f, 0.0f);
+    mesh.addVertex(-1.0f, -1.0f, 0.0f, 0.0f, 1.0f);
+    mesh.addVertex(-1.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+    mesh.addVertex(1.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+    // Triangles (1, 2, 3) and (1, 4, 3) sharing a diagonal
+    mesh.addTriangle(0, 1, 2);
+    mesh.addTriangle(0, 3, 2);
+    mesh.doubleSided = true;
+    return mesh;
+}
+
+Mesh makeSubdividedPlane(int subdivisions) {
+    Mesh mesh;
+    int columns = subdivisions + 1;
+    // Texture mapped like the quad: s runs along +y, t along -x
+    for (int row = 0; row <= subdivisions; ++row) {
+        for (int column = 0; column <= subdivisions; ++column) {
+            float u = static_cast<float>(column) / subdivisions;
+            float v = static_cast<float>(row) / subdivisions;
+            mesh.addVertex(1.0f - 2.0f * v, -1.0f + 2.0f * u, 0.0f, u, v);
+        }
+    }
+    for (int row = 0; row < subdivisions; ++row) {
+        for (int column = 0; column < subdivisions; ++column) {
+            Uint32 corner = static_cast<Uint32>(row * columns + column);
+            mesh.addTriangle(corner, corner + 1, corner + columns + 1);
+            mesh.addTriangle(corner, corner + columns + 1, corner + columns);
+        }
+    }
+    return mesh;
+}
+
+namespace {
+
+// OBJ indices are 1-based, negative ones count back from the end
+bool resolveObjIndex(int index, size_t count, size_t& resolved) {
+    if (index > 0 && static_cast<size_t>(index) <= count) {
+        resolved = static_cast<size_t>(index - 1);
+        return true;
+    }
+    if (index < 0 && static_cast<size_t>(-index) <= count) {
+        resolved = count - static_cast<size_t>(-index);
+        return true;
+    }
+    return false;
+}
+
+}
+
+bool loadObjMesh(const std::string& path, Mesh& mesh) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open mesh: " << path << std::endl;
+        return false;
+    }
+
+    struct Position {
+        float x, y, z;
+    };
+    struct UV {
+        float s, t;
+    };
+    std::vector<Position> positions;
+    std::vector<UV> uvs;
+    // One mesh vertex per distinct position/texture coordinate pair
+    std::map<std::pair<size_t, size_t>, Uint32> vertexIds;
+
+    mesh = Mesh();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (keyword == "v") {
+            Position position = {0.0f, 0.0f, 0.0f};
+            stream >> position.x >> position.y >> position.z;
+            positions.push_back(position);
+        } else if (keyword == "vt") {
+            UV uv = {0.0f, 0.0f};
+            stream >> uv.s >> uv.t;
+            uvs.push_back(uv);
+        } else if (keyword == "f") {
+            std::vector<Uint32> face;
+            std::string corner;
+            while (stream >> corner) {
+                // v, v/vt, v//vn or v/vt/vn
+                int positionIndex = 0, uvIndex = 0;
+                size_t slash = corner.find('/');
+                positionIndex = std::atoi(corner.substr(0, slash).c_str());
+                if (slash != std::string::npos && slash + 1 < corner.size() && corner[slash + 1] != '/')
+                    uvIndex = std::atoi(corner.c_str() + slash + 1);
+
+                size_t position, uv = SIZE_MAX;
+                if (!resolveObjIndex(positionIndex, positions.size(), position) || (uvIndex != 0 && !resolveObjIndex(uvIndex, uvs.size(), uv))) {
+                    std::cerr << "Invalid face index in " << path << " at line " << lineNumber << std::endl;
+                    return false;
+                }
+
+                auto inserted = vertexIds.emplace(std::make_pair(position, uv), static_cast<Uint32>(mesh.vertexCount()));
+                if (inserted.second) {
+                    const Position& p = positions[position];
+                    // OBJ puts t = 0 at the bottom of the image
+                    UV texCoord = uv == SIZE_MAX ? UV{0.0f, 0.0f} : UV{uvs[uv].s, 1.0f - uvs[uv].t};
+                    mesh.addVertex(p.x, p.y, p.z, texCoord.s, texCoord.t);
+                }
+                face.push_back(inserted.first->second);
+            }
+            for (size_t i = 2; i < face.size(); ++i)
+                mesh.addTriangle(face[0], face[i - 1], face[i]);
+        }
+    }
+
+    if (mesh.triangleCount() == 0) {
+        std::cerr << "Mesh has no faces: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,150 @@
+#include "rasterizer.h"
+
+#include <cmath>
+
+namespace {
+
+// Vertices further than this many pixels from the origin are rejected so the
+// fixed-point edge products stay well inside 64 bits
+const double MAX_SNAP_COORDINATE = static_cast<double>(1 << 20);
+
+struct SnappedVertex {
+    int64_t x, y;
+};
+
+bool snapVertex(const Point& p, SnappedVertex& snapped) {
+    if (!std::isfinite(p.x) || !std::isfinite(p.y))
+        return false;
+    if (std::fabs(p.x) > MAX_SNAP_COORDINATE || std::fabs(p.y) > MAX_SNAP_COORDINATE)
+        return false;
+    snapped.x = std::llround(static_cast<double>(p.x) * SUBPIXEL_ONE);
+    snapped.y = std::llround(static_cast<double>(p.y) * SUBPIXEL_ONE);
+    return true;
+}
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if (a % b != 0 && a < 0)
+        --q;
+    return q;
+}
+
+int64_t ceilDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if (a % b != 0 && a > 0)
+        ++q;
+    return q;
+}
+
+// Edge from a to b, positive on the inside of a clockwise-on-screen triangle
+// (y grows downwards). Top and left edges own the pixels centred exactly on
+// them, so the diagonal shared by two triangles is drawn exactly once.
+EdgeFunction makeEdge(const SnappedVertex& a, const SnappedVertex& b) {
+    int64_t dx = b.x - a.x;
+    int64_t dy = b.y - a.y;
+    bool isTopLeft = dy < 0 || (dy == 0 && dx > 0);
+    const int64_t half = SUBPIXEL_ONE / 2;
+
+    EdgeFunction edge;
+    edge.a = -dy * SUBPIXEL_ONE;
+    edge.b = dx * SUBPIXEL_ONE;
+    edge.c = dx * (half - a.y) - dy * (half - a.x) - (isTopLeft ? 0 : 1);
+    return edge;
+}
+
+struct PlaneBasis {
+    double x0, y0;          // first vertex
+    double e1x, e1y;        // v2 - v1
+    double e2x, e2y;        // v3 - v1
+    double invArea;
+    double originX, originY;
+};
+
+AttributePlane makePlane(const PlaneBasis& basis, double u1, double u2, double u3) {
+    double du1 = u2 - u1;
+    double du2 = u3 - u1;
+    double dudx = (du1 * basis.e2y - du2 * basis.e1y) * basis.invArea;
+    double dudy = (du2 * basis.e1x - du1 * basis.e2x) * basis.invArea;
+    double base = u1 + dudx * (basis.originX - basis.x0) + dudy * (basis.originY - basis.y0);
+    return {static_cast<float>(base), static_cast<float>(dudx), static_cast<float>(dudy)};
+}
+
+}
+
+bool setupTriangle(const RasterVertex& v1, const RasterVertex& v2, const RasterVertex& v3, const ClipRect& clip, TriangleSetup& setup) {
+    SnappedVertex p1, p2, p3;
+    if (!snapVertex(v1.position, p1) || !snapVertex(v2.position, p2) || !snapVertex(v3.position, p3))
+        return false;
+
+    int64_t area2 = (p2.x - p1.x) * (p3.y - p1.y) - (p2.y - p1.y) * (p3.x - p1.x);
+    if (area2 == 0)
+        return false;
+
+    // Pixel centres (x + 0.5, y + 0.5) inside the snapped bounding box
+    const int64_t half = SUBPIXEL_ONE / 2;
+    int64_t minX = std::min({p1.x, p2.x, p3.x});
+    int64_t maxX = std::max({p1.x, p2.x, p3.x});
+    int64_t minY = std::min({p1.y, p2.y, p3.y});
+    int64_t maxY = std::max({p1.y, p2.y, p3.y});
+    int64_t x0 = std::max<int64_t>(ceilDiv(minX - half, SUBPIXEL_ONE), clip.x0);
+    int64_t x1 = std::min<int64_t>(floorDiv(maxX - half, SUBPIXEL_ONE) + 1, clip.x1);
+    int64_t y0 = std::max<int64_t>(ceilDiv(minY - half, SUBPIXEL_ONE), clip.y0);
+    int64_t y1 = std::min<int64_t>(floorDiv(maxY - half, SUBPIXEL_ONE) + 1, clip.y1);
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+    setup.bounds = {static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1), static_cast<int>(y1)};
+
+    // Edge functions expect a positive area, so flip counter-clockwise input
+    if (area2 > 0) {
+        setup.edges[0] = makeEdge(p1, p2);
+        setup.edges[1] = makeEdge(p2, p3);
+        setup.edges[2] = makeEdge(p3, p1);
+    } else {
+        setup.edges[0] = makeEdge(p1, p3);
+        setup.edges[1] = makeEdge(p3, p2);
+        setup.edges[2] = makeEdge(p2, p1);
+    }
+
+    // Gradients use the snapped positions so they agree with the coverage test
+    PlaneBasis basis;
+    basis.x0 = static_cast<double>(p1.x) / SUBPIXEL_ONE;
+    basis.y0 = static_cast<double>(p1.y) / SUBPIXEL_ONE;
+    basis.e1x = static_cast<double>(p2.x - p1.x) / SUBPIXEL_ONE;
+    basis.e1y = static_cast<double>(p2.y - p1.y) / SUBPIXEL_ONE;
+    basis.e2x = static_cast<double>(p3.x - p1.x) / SUBPIXEL_ONE;
+    basis.e2y = static_cast<double>(p3.y - p1.y) / SUBPIXEL_ONE;
+    basis.invArea = static_cast<double>(SUBPIXEL_ONE * SUBPIXEL_ONE) / static_cast<double>(area2);
+    basis.originX = static_cast<double>(setup.bounds.x0) + 0.5;
+    basis.originY = static_cast<double>(setup.bounds.y0) + 0.5;
+
+    setup.s = makePlane(basis, v1.texCoord.s, v2.texCoord.s, v3.texCoord.s);
+    setup.t = makePlane(basis, v1.texCoord.t, v2.texCoord.t, v3.texCoord.t);
+
+    double q1 = 1.0 / v1.w;
+    double q2 = 1.0 / v2.w;
+    double q3 = 1.0 / v3.w;
+    setup.q = makePlane(basis, q1, q2, q3);
+    setup.sq = makePlane(basis, v1.texCoord.s * q1, v2.texCoord.s * q2, v3.texCoord.s * q3);
+    setup.tq = makePlane(basis, v1.texCoord.t * q1, v2.texCoord.t * q2, v3.texCoord.t * q3);
+    return true;
+}
+
+bool edgeSpan(const TriangleSetup& setup, const int64_t rowEdge[3], int& x0, int& x1) {
+    int64_t lo = setup.bounds.x0;
+    int64_t hi = setup.bounds.x1;
+    for (int i = 0; i < 3; ++i) {
+        int64_t a = setup.edges[i].a;
+        int64_t value = rowEdge[i];
+        if (a > 0)
+            lo = std::max(lo, ceilDiv(-value, a));
+        else if (a < 0)
+            hi = std::min(hi, floorDiv(value, -a) + 1);
+        else if (value < 0)
+            return false;
+    }
+    if (lo >= hi)
+        return false;
+    x0 = static_cast<int>(lo);
+    x1 = static_cast<int>(hi);
+    return true;
+}
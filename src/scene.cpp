@@ -0,0 +1,65 @@
+#include "scene.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+glm::mat4 sceneProjection(int width, int height) {
+    // Create a Perspective matrix using glm::perspective
+    float fieldOfView = glm::radians(45.0f);
+    float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+    float nearPlane = 0.1f;
+    float farPlane = 100.0f;
+    return glm::perspective(fieldOfView, aspectRatio, nearPlane, farPlane);
+}
+
+glm::mat4 sceneModelViewProjection(const glm::mat4& projection, const SceneView& view) {
+    glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);     // Camera target point in world coordinates
+    glm::vec3 cameraUp = glm::vec3(0.0f, 0.0f, 1.0f);         // Up vector for the camera
+
+    // Create a view matrix using glm::lookAt
+    glm::mat4 viewMatrix = glm::lookAt(view.cameraPosition, cameraTarget, cameraUp);
+    // Roll the camera about its line of sight, which is -z in view space
+    if (view.cameraRoll != 0.0f)
+        viewMatrix = glm::rotate(glm::mat4(1.0f), view.cameraRoll, glm::vec3(0.0f, 0.0f, -1.0f)) * viewMatrix;
+    // Create a model matrix for continuous rotation around the z-axis
+    glm::mat4 modelMatrix = glm::rotate(glm::mat4(1.0f), view.rotationAngle, glm::vec3(0.0f, 0.0f, 1.0f));
+    // Combine the model, view and perspective matrices into the final transformation matrix
+    return projection * viewMatrix * modelMatrix;
+}
+
+bool loadSceneMesh(const std::string& name, Mesh& mesh) {
+    if (name == "quad") {
+        mesh = makeQuadMesh();
+        return true;
+    }
+    if (name.compare(0, 6, "plane:") == 0) {
+        int subdivisions = std::atoi(name.c_str() + 6);
+        if (subdivisions < 1) {
+            std::cerr << "Invalid plane subdivision: " << name << std::endl;
+            return false;
+        }
+        mesh = makeSubdividedPlane(subdivisions);
+        return true;
+    }
+    return loadObjMesh(name, mesh);
+}
+
+void submitMesh(GeometryPipeline& geometry, const Mesh& mesh, const glm::mat4& modelViewProjection, int width, int height, MappingMode mode, SpanShader shader, const Texture& texture, TileRenderer& renderer, FrameProfile* profile) {
+    int64_t start = profile ? profileNow() : 0;
+    const std::vector<ScreenTriangle>& triangles = geometry.process(mesh, modelViewProjection, width, height);
+    int64_t transformed = profile ? profileNow() : 0;
+
+    const ClipRect screen = {0, 0, width, height};
+    for (const ScreenTriangle& triangle : triangles) {
+        TriangleSetup setup;
+        if (setupTriangle(triangle.vertices[0], triangle.vertices[1], triangle.vertices[2], screen, setup))
+            renderer.addTriangle({setup, mode, shader, &texture});
+    }
+
+    if (profile) {
+        int64_t setUp = profileNow();
+        profile->add(ProfileStage::Transform, transformed - start);
+        profile->add(ProfileStage::Setup, setUp - transformed);
+    }
+}
@@ -0,0 +1,290 @@
+#include "span_shader.h"
+#include "span_kernels.h"
+
+#include <algorithm>
+
+#if SPAN_SHADER_X86
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if SPAN_SHADER_X86
+// Same operations as nearestTexel(); MAXPS and MINPS return their second
+// operand when either is NaN, like maxps() and minps()
+template <TextureAddress Address>
+inline __m128i nearestTexelsSSE2(__m128 s, __m128 size) {
+    if constexpr (Address == TextureAddress::Clamp) {
+        __m128 limit = _mm_sub_ps(size, _mm_set1_ps(1.0f));
+        return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(s, size), _mm_setzero_ps()), limit));
+    } else {
+        const __m128 one = _mm_set1_ps(1.0f);
+        __m128 clamped = _mm_min_ps(_mm_max_ps(s, _mm_set1_ps(-WRAP_LIMIT)), _mm_set1_ps(WRAP_LIMIT));
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(clamped));
+        __m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, clamped), one));
+        __m128 fraction = _mm_sub_ps(clamped, floored);
+        return _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(fraction, size), _mm_sub_ps(size, one)));
+    }
+}
+
+template <PixelFormat Format>
+inline __m128i framebufferColorsSSE2(__m128i argb) {
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    if constexpr (Format == PixelFormat::ARGB8888) {
+        return _mm_or_si128(argb, alpha);
+    } else {
+        __m128i green = _mm_and_si128(argb, _mm_set1_epi32(0x0000FF00));
+        __m128i red = _mm_and_si128(_mm_srli_epi32(argb, 16), _mm_set1_epi32(0xFF));
+        __m128i blue = _mm_slli_epi32(_mm_and_si128(argb, _mm_set1_epi32(0xFF)), 16);
+        return _mm_or_si128(_mm_or_si128(green, alpha), _mm_or_si128(red, blue));
+    }
+}
+
+template <TextureAddress Address, PixelFormat Format>
+inline void storeTexelsSSE2(const TextureView& texture, __m128 s, __m128 t, Uint32* out) {
+    // SSE2 has neither a 32-bit multiply nor a gather, so address and fetch per lane
+    alignas(16) int texX[4];
+    alignas(16) int texY[4];
+    alignas(16) Uint32 texels[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(texX), nearestTexelsSSE2<Address>(s, _mm_set1_ps(static_cast<float>(texture.width))));
+    _mm_store_si128(reinterpret_cast<__m128i*>(texY), nearestTexelsSSE2<Address>(t, _mm_set1_ps(static_cast<float>(texture.height))));
+    for (int lane = 0; lane < 4; ++lane)
+        texels[lane] = texture.texels[tiledTexelIndex(texX[lane], texY[lane], texture.blocksPerRow)];
+    __m128i colors = framebufferColorsSSE2<Format>(_mm_load_si128(reinterpret_cast<const __m128i*>(texels)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), colors);
+}
+
+template <MappingMode Mapping, TextureAddress Address, PixelFormat Format>
+void shadeSpanSSE2(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    const ClipRect& origin = setup.bounds;
+    float fy = static_cast<float>(y - origin.y0);
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    int x = x0;
+    if constexpr (Mapping == MappingMode::Affine) {
+        __m128 sRow = _mm_set1_ps(setup.s.base + setup.s.dy * fy);
+        __m128 tRow = _mm_set1_ps(setup.t.base + setup.t.dy * fy);
+        __m128 sdx = _mm_set1_ps(setup.s.dx);
+        __m128 tdx = _mm_set1_ps(setup.t.dx);
+        for (; x + 4 <= x1; x += 4) {
+            __m128 fx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - origin.x0)), lanes);
+            __m128 s = _mm_add_ps(sRow, _mm_mul_ps(sdx, fx));
+            __m128 t = _mm_add_ps(tRow, _mm_mul_ps(tdx, fx));
+            storeTexelsSSE2<Address, Format>(texture, s, t, row + x);
+        }
+    } else {
+        __m128 qRow = _mm_set1_ps(setup.q.base + setup.q.dy * fy);
+        __m128 sqRow = _mm_set1_ps(setup.sq.base + setup.sq.dy * fy);
+        __m128 tqRow = _mm_set1_ps(setup.tq.base + setup.tq.dy * fy);
+        __m128 qdx = _mm_set1_ps(setup.q.dx);
+        __m128 sqdx = _mm_set1_ps(setup.sq.dx);
+        __m128 tqdx = _mm_set1_ps(setup.tq.dx);
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; x + 4 <= x1; x += 4) {
+            __m128 fx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - origin.x0)), lanes);
+            // Exact divide rather than rcpps so the result matches the scalar path
+            __m128 w = _mm_div_ps(one, _mm_add_ps(qRow, _mm_mul_ps(qdx, fx)));
+            __m128 s = _mm_mul_ps(_mm_add_ps(sqRow, _mm_mul_ps(sqdx, fx)), w);
+            __m128 t = _mm_mul_ps(_mm_add_ps(tqRow, _mm_mul_ps(tqdx, fx)), w);
+            storeTexelsSSE2<Address, Format>(texture, s, t, row + x);
+        }
+    }
+    shadeSpanScalar<Mapping, TextureFilter::Nearest, Address, Format>(setup, texture, y, x, x1, row);
+}
+
+template <int Step, TextureAddress Address, PixelFormat Format>
+void shadeSubdividedSpanSSE2(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    static_assert(Step % 4 == 0, "subdivision steps must be whole SSE2 vectors");
+    const ClipRect& origin = setup.bounds;
+    float fy = static_cast<float>(y - origin.y0);
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 qRow = _mm_set1_ps(setup.q.base + setup.q.dy * fy);
+    __m128 sqRow = _mm_set1_ps(setup.sq.base + setup.sq.dy * fy);
+    __m128 tqRow = _mm_set1_ps(setup.tq.base + setup.tq.dy * fy);
+    __m128 qdx = _mm_set1_ps(setup.q.dx);
+    __m128 sqdx = _mm_set1_ps(setup.sq.dx);
+    __m128 tqdx = _mm_set1_ps(setup.tq.dx);
+    const __m128 one = _mm_set1_ps(1.0f);
+    alignas(16) int anchors[4];
+    alignas(16) float endS[4];
+    alignas(16) float endT[4];
+
+    alignas(16) float startS[4], startT[4], slopeS[4], slopeT[4];
+    const __m128 inverseStep = _mm_set1_ps(1.0f / static_cast<float>(Step));
+
+    TexCoord start = perspectivelyCorrectTextureMapping(setup, x0, y);
+    for (int x = x0; x < x1;) {
+        // Exact coordinates at the anchors of the next four segments in one
+        // divide; anchors past the end of the span repeat the last pixel
+        int groupStart = x;
+        for (int k = 0; k < 4; ++k)
+            anchors[k] = segmentAnchor(groupStart + k * Step, x1, Step) - origin.x0;
+        __m128 fx = _mm_cvtepi32_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(anchors)));
+        __m128 w = _mm_div_ps(one, _mm_add_ps(qRow, _mm_mul_ps(qdx, fx)));
+        __m128 sEnd = _mm_mul_ps(_mm_add_ps(sqRow, _mm_mul_ps(sqdx, fx)), w);
+        __m128 tEnd = _mm_mul_ps(_mm_add_ps(tqRow, _mm_mul_ps(tqdx, fx)), w);
+        // Each segment starts where the one before it ends
+        __m128 sStart = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sEnd), 4)), _mm_set_ss(start.s));
+        __m128 tStart = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(tEnd), 4)), _mm_set_ss(start.t));
+        _mm_store_ps(startS, sStart);
+        _mm_store_ps(startT, tStart);
+        _mm_store_ps(slopeS, _mm_mul_ps(_mm_sub_ps(sEnd, sStart), inverseStep));
+        _mm_store_ps(slopeT, _mm_mul_ps(_mm_sub_ps(tEnd, tStart), inverseStep));
+        _mm_store_ps(endS, sEnd);
+        _mm_store_ps(endT, tEnd);
+
+        // Only the last segment of the group can be short; its slope comes
+        // from spanSegment() like the scalar shader's
+        int groupEnd = std::min(groupStart + 4 * Step, x1);
+        int last = (groupEnd - 1 - groupStart) / Step;
+        SpanSegment lastSegment = spanSegment(groupStart + last * Step, x1, Step, {startS[last], startT[last]}, {endS[last], endT[last]});
+        slopeS[last] = lastSegment.slope.s;
+        slopeT[last] = lastSegment.slope.t;
+
+        // Step is a multiple of four, so no vector straddles two segments
+        for (; x + 4 <= groupEnd; x += 4) {
+            int k = (x - groupStart) / Step;
+            __m128 fx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - groupStart - k * Step)), lanes);
+            __m128 s = _mm_add_ps(_mm_set1_ps(startS[k]), _mm_mul_ps(_mm_set1_ps(slopeS[k]), fx));
+            __m128 t = _mm_add_ps(_mm_set1_ps(startT[k]), _mm_mul_ps(_mm_set1_ps(slopeT[k]), fx));
+            storeTexelsSSE2<Address, Format>(texture, s, t, row + x);
+        }
+        shadeSegmentScalar<TextureFilter::Nearest, Address, Format>(lastSegment, texture, x, row);
+        start = lastSegment.end;
+        x = groupEnd;
+    }
+}
+
+struct SSE2SpanShaders {
+    template <size_t Index>
+    static constexpr SpanShader variant() {
+        using Variant = SpanShaderVariant<Index>;
+        if constexpr (Variant::filter != TextureFilter::Nearest)
+            return ScalarSpanShaders::variant<Index>();
+        else if constexpr (Variant::mapping == MappingMode::Subdivided)
+            return &shadeSubdividedSpanSSE2<Variant::subdivisionStep, Variant::address, Variant::format>;
+        else
+            return &shadeSpanSSE2<Variant::mapping, Variant::address, Variant::format>;
+    }
+};
+#endif
+
+const SpanShaderTable SCALAR_SPAN_SHADERS = makeSpanShaderTable<ScalarSpanShaders>(std::make_index_sequence<SPAN_SHADER_VARIANT_COUNT>());
+
+}
+
+void mapSpanTexCoords(const TriangleSetup& setup, MappingMode mode, int subdivisionStep, int y, int x0, int x1, TexCoord* texCoords) {
+    if (mode == MappingMode::Affine) {
+        for (int x = x0; x < x1; ++x)
+            texCoords[x - x0] = affineTextureMapping(setup, x, y);
+    } else if (mode == MappingMode::Perspective) {
+        for (int x = x0; x < x1; ++x)
+            texCoords[x - x0] = perspectivelyCorrectTextureMapping(setup, x, y);
+    } else {
+        int step = SPAN_SUBDIVISION_STEPS[subdivisionStepIndex(subdivisionStep)];
+        TexCoord start = perspectivelyCorrectTextureMapping(setup, x0, y);
+        for (int x = x0; x < x1;) {
+            SpanSegment segment = subdivideSpan(setup, y, x, x1, step, start);
+            for (; x < segment.x1; ++x)
+                texCoords[x - x0] = segmentTexCoord(segment, x);
+            start = segment.end;
+        }
+    }
+}
+
+int selectMipLevel(const TriangleSetup& setup, MappingMode mode, const Texture& texture, int y, int x0, int x1) {
+    const TextureView& base = texture.level(0);
+    float dsdx = setup.s.dx, dsdy = setup.s.dy;
+    float dtdx = setup.t.dx, dtdy = setup.t.dy;
+    if (mode != MappingMode::Affine) {
+        // d(sq / q) = (dsq - s * dq) / q at the centre of the span
+        int x = (x0 + x1 - 1) / 2;
+        float w = 1.0f / evaluatePlane(setup.q, x, y, setup.bounds);
+        float s = evaluatePlane(setup.sq, x, y, setup.bounds) * w;
+        float t = evaluatePlane(setup.tq, x, y, setup.bounds) * w;
+        dsdx = (setup.sq.dx - s * setup.q.dx) * w;
+        dsdy = (setup.sq.dy - s * setup.q.dy) * w;
+        dtdx = (setup.tq.dx - t * setup.q.dx) * w;
+        dtdy = (setup.tq.dy - t * setup.q.dy) * w;
+    }
+
+    float width = static_cast<float>(base.width);
+    float height = static_cast<float>(base.height);
+    float lengthX = dsdx * dsdx * width * width + dtdx * dtdx * height * height;
+    float lengthY = dsdy * dsdy * width * width + dtdy * dtdy * height * height;
+    float footprint = std::max(lengthX, lengthY);
+
+    // Level k covers log2 of the footprint in [k - 0.5, k + 0.5); compare the
+    // squared footprint against 2^(2k + 1) instead of taking a logarithm
+    int level = 0;
+    float threshold = 2.0f;
+    while (level + 1 < texture.levelCount() && footprint >= threshold) {
+        ++level;
+        threshold *= 4.0f;
+    }
+    return level;
+}
+
+#if SPAN_SHADER_X86
+const SpanShaderTable& sse2SpanShaders() {
+    static const SpanShaderTable table = makeSpanShaderTable<SSE2SpanShaders>(std::make_index_sequence<SPAN_SHADER_VARIANT_COUNT>());
+    return table;
+}
+#endif
+
+SimdLevel detectSimdLevel() {
+#if SPAN_SHADER_X86
+    if (SDL_HasAVX2())
+        return SimdLevel::AVX2;
+    if (SDL_HasSSE2())
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        default:
+            return "scalar";
+    }
+}
+
+const char* mappingModeName(MappingMode mode) {
+    switch (mode) {
+        case MappingMode::Perspective:
+            return "perspective";
+        case MappingMode::Subdivided:
+            return "subdivided";
+        default:
+            return "affine";
+    }
+}
+
+const char* textureFilterName(TextureFilter filter) {
+    return filter == TextureFilter::Bilinear ? "bilinear" : "nearest";
+}
+
+const char* textureAddressName(TextureAddress address) {
+    return address == TextureAddress::Wrap ? "wrap" : "clamp";
+}
+
+SpanShader selectSpanShader(const PixelPipelineState& state, SimdLevel level) {
+    int variant = spanShaderVariant(state);
+#if SPAN_SHADER_X86
+    switch (level) {
+        case SimdLevel::AVX2:
+            return avx2SpanShaders()[variant];
+        case SimdLevel::SSE2:
+            return sse2SpanShaders()[variant];
+        default:
+            break;
+    }
+#else
+    (void)level;
+#endif
+    return SCALAR_SPAN_SHADERS[variant];
+}
@@ -0,0 +1,180 @@
+#include "span_shader.h"
+#include "span_kernels.h"
+
+#if SPAN_SHADER_X86
+#include <immintrin.h>
+
+// Built with a per-function target instead of -mavx2 for the whole file, so
+// no inline function from a shared header is emitted with AVX2 instructions
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+// Same operations as nearestTexel(), eight lanes at a time
+template <TextureAddress Address>
+TARGET_AVX2 inline __m256i nearestTexelsAVX2(__m256 s, __m256 size) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    if constexpr (Address == TextureAddress::Clamp) {
+        return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(s, size), _mm256_setzero_ps()), _mm256_sub_ps(size, one)));
+    } else {
+        __m256 clamped = _mm256_min_ps(_mm256_max_ps(s, _mm256_set1_ps(-WRAP_LIMIT)), _mm256_set1_ps(WRAP_LIMIT));
+        __m256 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(clamped));
+        __m256 floored = _mm256_sub_ps(truncated, _mm256_and_ps(_mm256_cmp_ps(truncated, clamped, _CMP_GT_OQ), one));
+        __m256 fraction = _mm256_sub_ps(clamped, floored);
+        return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(fraction, size), _mm256_sub_ps(size, one)));
+    }
+}
+
+template <PixelFormat Format>
+TARGET_AVX2 inline __m256i framebufferColorsAVX2(__m256i argb) {
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    if constexpr (Format == PixelFormat::ARGB8888) {
+        return _mm256_or_si256(argb, alpha);
+    } else {
+        // Swap the red and blue bytes of every pixel
+        const __m256i swapRedBlue = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        return _mm256_or_si256(_mm256_shuffle_epi8(argb, swapRedBlue), alpha);
+    }
+}
+
+template <TextureAddress Address, PixelFormat Format>
+TARGET_AVX2 inline void storeTexelsAVX2(const TextureView& texture, __m256 s, __m256 t, Uint32* out) {
+    __m256i texX = nearestTexelsAVX2<Address>(s, _mm256_set1_ps(static_cast<float>(texture.width)));
+    __m256i texY = nearestTexelsAVX2<Address>(t, _mm256_set1_ps(static_cast<float>(texture.height)));
+
+    // Block-order address, as tiledTexelIndex(). Addressing has already
+    // brought every lane onto the texture, so the gather needs no mask.
+    __m256i blockMask = _mm256_set1_epi32(TEXTURE_BLOCK_SIZE - 1);
+    __m256i block = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(texY, TEXTURE_BLOCK_BITS), _mm256_set1_epi32(texture.blocksPerRow)), _mm256_srli_epi32(texX, TEXTURE_BLOCK_BITS));
+    __m256i inBlock = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(texY, blockMask), TEXTURE_BLOCK_BITS), _mm256_and_si256(texX, blockMask));
+    __m256i index = _mm256_add_epi32(_mm256_slli_epi32(block, 2 * TEXTURE_BLOCK_BITS), inBlock);
+    __m256i texels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texture.texels), index, 4);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), framebufferColorsAVX2<Format>(texels));
+}
+
+template <MappingMode Mapping, TextureAddress Address, PixelFormat Format>
+TARGET_AVX2 void shadeSpanAVX2(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    const ClipRect& origin = setup.bounds;
+    float fy = static_cast<float>(y - origin.y0);
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    int x = x0;
+    if constexpr (Mapping == MappingMode::Affine) {
+        __m256 sRow = _mm256_set1_ps(setup.s.base + setup.s.dy * fy);
+        __m256 tRow = _mm256_set1_ps(setup.t.base + setup.t.dy * fy);
+        __m256 sdx = _mm256_set1_ps(setup.s.dx);
+        __m256 tdx = _mm256_set1_ps(setup.t.dx);
+        for (; x + 8 <= x1; x += 8) {
+            __m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - origin.x0)), lanes);
+            __m256 s = _mm256_add_ps(sRow, _mm256_mul_ps(sdx, fx));
+            __m256 t = _mm256_add_ps(tRow, _mm256_mul_ps(tdx, fx));
+            storeTexelsAVX2<Address, Format>(texture, s, t, row + x);
+        }
+    } else {
+        __m256 qRow = _mm256_set1_ps(setup.q.base + setup.q.dy * fy);
+        __m256 sqRow = _mm256_set1_ps(setup.sq.base + setup.sq.dy * fy);
+        __m256 tqRow = _mm256_set1_ps(setup.tq.base + setup.tq.dy * fy);
+        __m256 qdx = _mm256_set1_ps(setup.q.dx);
+        __m256 sqdx = _mm256_set1_ps(setup.sq.dx);
+        __m256 tqdx = _mm256_set1_ps(setup.tq.dx);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        for (; x + 8 <= x1; x += 8) {
+            __m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - origin.x0)), lanes);
+            __m256 w = _mm256_div_ps(one, _mm256_add_ps(qRow, _mm256_mul_ps(qdx, fx)));
+            __m256 s = _mm256_mul_ps(_mm256_add_ps(sqRow, _mm256_mul_ps(sqdx, fx)), w);
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(tqRow, _mm256_mul_ps(tqdx, fx)), w);
+            storeTexelsAVX2<Address, Format>(texture, s, t, row + x);
+        }
+    }
+    shadeSpanScalar<Mapping, TextureFilter::Nearest, Address, Format>(setup, texture, y, x, x1, row);
+}
+
+template <int Step, TextureAddress Address, PixelFormat Format>
+TARGET_AVX2 void shadeSubdividedSpanAVX2(const TriangleSetup& setup, const TextureView& texture, int y, int x0, int x1, Uint32* row) {
+    static_assert(Step % 8 == 0, "subdivision steps must be whole AVX2 vectors");
+    const ClipRect& origin = setup.bounds;
+    float fy = static_cast<float>(y - origin.y0);
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 qRow = _mm256_set1_ps(setup.q.base + setup.q.dy * fy);
+    __m256 sqRow = _mm256_set1_ps(setup.sq.base + setup.sq.dy * fy);
+    __m256 tqRow = _mm256_set1_ps(setup.tq.base + setup.tq.dy * fy);
+    __m256 qdx = _mm256_set1_ps(setup.q.dx);
+    __m256 sqdx = _mm256_set1_ps(setup.sq.dx);
+    __m256 tqdx = _mm256_set1_ps(setup.tq.dx);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    alignas(32) int anchors[8];
+    alignas(32) float endS[8];
+    alignas(32) float endT[8];
+
+    alignas(32) float startS[8], startT[8], slopeS[8], slopeT[8];
+    const __m256i previousLane = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256 inverseStep = _mm256_set1_ps(1.0f / static_cast<float>(Step));
+
+    TexCoord start = perspectivelyCorrectTextureMapping(setup, x0, y);
+    for (int x = x0; x < x1;) {
+        // Exact coordinates at the anchors of the next eight segments in one
+        // divide; anchors past the end of the span repeat the last pixel
+        int groupStart = x;
+        for (int k = 0; k < 8; ++k)
+            anchors[k] = segmentAnchor(groupStart + k * Step, x1, Step) - origin.x0;
+        __m256 fx = _mm256_cvtepi32_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(anchors)));
+        __m256 w = _mm256_div_ps(one, _mm256_add_ps(qRow, _mm256_mul_ps(qdx, fx)));
+        __m256 sEnd = _mm256_mul_ps(_mm256_add_ps(sqRow, _mm256_mul_ps(sqdx, fx)), w);
+        __m256 tEnd = _mm256_mul_ps(_mm256_add_ps(tqRow, _mm256_mul_ps(tqdx, fx)), w);
+        // Each segment starts where the one before it ends
+        __m256 sStart = _mm256_blend_ps(_mm256_permutevar8x32_ps(sEnd, previousLane), _mm256_set1_ps(start.s), 1);
+        __m256 tStart = _mm256_blend_ps(_mm256_permutevar8x32_ps(tEnd, previousLane), _mm256_set1_ps(start.t), 1);
+        _mm256_store_ps(startS, sStart);
+        _mm256_store_ps(startT, tStart);
+        _mm256_store_ps(slopeS, _mm256_mul_ps(_mm256_sub_ps(sEnd, sStart), inverseStep));
+        _mm256_store_ps(slopeT, _mm256_mul_ps(_mm256_sub_ps(tEnd, tStart), inverseStep));
+        _mm256_store_ps(endS, sEnd);
+        _mm256_store_ps(endT, tEnd);
+
+        // Only the last segment of the group can be short; its slope comes
+        // from spanSegment() like the scalar shader's
+        int groupEnd = std::min(groupStart + 8 * Step, x1);
+        int last = (groupEnd - 1 - groupStart) / Step;
+        SpanSegment lastSegment = spanSegment(groupStart + last * Step, x1, Step, {startS[last], startT[last]}, {endS[last], endT[last]});
+        slopeS[last] = lastSegment.slope.s;
+        slopeT[last] = lastSegment.slope.t;
+
+        // Step is a multiple of eight, so no vector straddles two segments
+        for (; x + 8 <= groupEnd; x += 8) {
+            int k = (x - groupStart) / Step;
+            __m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - groupStart - k * Step)), lanes);
+            __m256 s = _mm256_add_ps(_mm256_set1_ps(startS[k]), _mm256_mul_ps(_mm256_set1_ps(slopeS[k]), fx));
+            __m256 t = _mm256_add_ps(_mm256_set1_ps(startT[k]), _mm256_mul_ps(_mm256_set1_ps(slopeT[k]), fx));
+            storeTexelsAVX2<Address, Format>(texture, s, t, row + x);
+        }
+        shadeSegmentScalar<TextureFilter::Nearest, Address, Format>(lastSegment, texture, x, row);
+        start = lastSegment.end;
+        x = groupEnd;
+    }
+}
+
+struct AVX2SpanShaders {
+    template <size_t Index>
+    static constexpr SpanShader variant() {
+        using Variant = SpanShaderVariant<Index>;
+        if constexpr (Variant::filter != TextureFilter::Nearest)
+            return ScalarSpanShaders::variant<Index>();
+        else if constexpr (Variant::mapping == MappingMode::Subdivided)
+            return &shadeSubdividedSpanAVX2<Variant::subdivisionStep, Variant::address, Variant::format>;
+        else
+            return &shadeSpanAVX2<Variant::mapping, Variant::address, Variant::format>;
+    }
+};
+
+}
+
+const SpanShaderTable& avx2SpanShaders() {
+    static const SpanShaderTable table = makeSpanShaderTable<AVX2SpanShaders>(std::make_index_sequence<SPAN_SHADER_VARIANT_COUNT>());
+    return table;
+}
+
+#endif
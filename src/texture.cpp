@@ -0,0 +1,274 @@
+#include "texture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+
+namespace {
+
+const size_t CACHE_LINE = 64;
+
+int blocksFor(int size) {
+    return (size + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+}
+
+size_t levelTexelCount(int width, int height) {
+    return static_cast<size_t>(blocksFor(width)) * blocksFor(height) * TEXTURE_BLOCK_SIZE * TEXTURE_BLOCK_SIZE;
+}
+
+// Averages each channel of four ARGB8888 texels, rounding to nearest
+Uint32 averageTexels(Uint32 a, Uint32 b, Uint32 c, Uint32 d) {
+    Uint32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        Uint32 sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) / 4) << shift;
+    }
+    return result;
+}
+
+// Writes a row-major image into block order. Padding texels repeat the last
+// row and column so a level never holds uninitialised memory.
+void storeTiled(const std::vector<Uint32>& image, int width, int height, Uint32* texels) {
+    int blocksPerRow = blocksFor(width);
+    int paddedWidth = blocksPerRow * TEXTURE_BLOCK_SIZE;
+    int paddedHeight = blocksFor(height) * TEXTURE_BLOCK_SIZE;
+    for (int y = 0; y < paddedHeight; ++y) {
+        const Uint32* source = image.data() + static_cast<size_t>(std::min(y, height - 1)) * width;
+        for (int x = 0; x < paddedWidth; ++x)
+            texels[tiledTexelIndex(x, y, blocksPerRow)] = source[std::min(x, width - 1)];
+    }
+}
+
+// 2x2 box filter; odd sizes clamp the last row or column
+std::vector<Uint32> downsample(const std::vector<Uint32>& image, int width, int height, int nextWidth, int nextHeight) {
+    std::vector<Uint32> next(static_cast<size_t>(nextWidth) * nextHeight);
+    for (int y = 0; y < nextHeight; ++y) {
+        const Uint32* row0 = image.data() + static_cast<size_t>(std::min(2 * y, height - 1)) * width;
+        const Uint32* row1 = image.data() + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width;
+        for (int x = 0; x < nextWidth; ++x) {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            next[static_cast<size_t>(y) * nextWidth + x] = averageTexels(row0[x0], row0[x1], row1[x0], row1[x1]);
+        }
+    }
+    return next;
+}
+
+// Cache file layout: the header, one CacheLevel per mip level, then the
+// texels of every level in block order, each level starting on a cache line.
+// Values are stored in the writer's byte order, which the reader checks.
+struct CacheHeader {
+    char magic[8];
+    Uint32 byteOrder;
+    Uint32 blockBits;
+    Uint64 sourceSize;
+    Sint64 sourceTime;      // modification time in file clock ticks
+    Uint32 levelCount;
+    Uint32 reserved;
+};
+
+struct CacheLevel {
+    Uint32 width, height;
+    Uint64 offset;          // from the start of the file
+};
+
+const char CACHE_MAGIC[8] = {'T', 'E', 'X', 'C', 'A', 'C', 'H', '1'};
+const Uint32 CACHE_BYTE_ORDER = 0x01020304u;
+const Uint32 MAX_CACHE_LEVELS = 32;
+
+struct SourceStamp {
+    Uint64 size;
+    Sint64 time;
+};
+
+bool readSourceStamp(const std::string& path, SourceStamp& stamp) {
+    std::error_code error;
+    std::uintmax_t size = std::filesystem::file_size(path, error);
+    if (error) {
+        SDL_SetError("Couldn't read %s: %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        SDL_SetError("Couldn't read %s: %s", path.c_str(), error.message().c_str());
+        return false;
+    }
+    stamp = {static_cast<Uint64>(size), static_cast<Sint64>(time.time_since_epoch().count())};
+    return true;
+}
+
+Uint64 cacheDataOffset(Uint64 levelCount) {
+    Uint64 tableEnd = sizeof(CacheHeader) + levelCount * sizeof(CacheLevel);
+    return (tableEnd + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+}
+
+void Texture::AlignedDelete::operator()(Uint32* texels) const {
+    ::operator delete[](texels, std::align_val_t(CACHE_LINE));
+}
+
+void Texture::reset() {
+    levels.clear();
+    storage.reset();
+    cache.close();
+}
+
+bool Texture::loadFromSurface(SDL_Surface* surface) {
+    reset();
+
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (!converted)
+        return false;
+    if (converted->w <= 0 || converted->h <= 0) {
+        SDL_FreeSurface(converted);
+        SDL_SetError("Texture has no pixels");
+        return false;
+    }
+
+    int width = converted->w;
+    int height = converted->h;
+    std::vector<Uint32> image(static_cast<size_t>(width) * height);
+    SDL_LockSurface(converted);
+    for (int y = 0; y < height; ++y) {
+        const Uint32* row = reinterpret_cast<const Uint32*>(static_cast<const Uint8*>(converted->pixels) + static_cast<size_t>(y) * converted->pitch);
+        std::copy(row, row + width, image.begin() + static_cast<size_t>(y) * width);
+    }
+    SDL_UnlockSurface(converted);
+    SDL_FreeSurface(converted);
+
+    // Lay out every level in one allocation, each starting on a cache line
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    for (int w = width, h = height;; w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+        offsets.push_back(total);
+        total += levelTexelCount(w, h);
+        if (w == 1 && h == 1)
+            break;
+    }
+    storage.reset(static_cast<Uint32*>(::operator new[](total * sizeof(Uint32), std::align_val_t(CACHE_LINE))));
+
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        Uint32* texels = storage.get() + offsets[i];
+        storeTiled(image, width, height, texels);
+        levels.push_back({texels, width, height, blocksFor(width)});
+
+        if (i + 1 < offsets.size()) {
+            int nextWidth = std::max(width / 2, 1);
+            int nextHeight = std::max(height / 2, 1);
+            image = downsample(image, width, height, nextWidth, nextHeight);
+            width = nextWidth;
+            height = nextHeight;
+        }
+    }
+    return true;
+}
+
+bool Texture::saveCache(const std::string& cachePath, const std::string& sourcePath) const {
+    if (levels.empty()) {
+        SDL_SetError("Texture has no pixels");
+        return false;
+    }
+    SourceStamp stamp;
+    if (!readSourceStamp(sourcePath, stamp))
+        return false;
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.blockBits = TEXTURE_BLOCK_BITS;
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.levelCount = static_cast<Uint32>(levels.size());
+
+    std::vector<CacheLevel> table;
+    Uint64 offset = cacheDataOffset(levels.size());
+    for (const TextureView& level : levels) {
+        table.push_back({static_cast<Uint32>(level.width), static_cast<Uint32>(level.height), offset});
+        offset += levelTexelCount(level.width, level.height) * sizeof(Uint32);
+    }
+
+    // Written under a temporary name and renamed into place, so a reader
+    // never maps a half-written file
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(CacheLevel)));
+        const char padding[CACHE_LINE] = {};
+        file.write(padding, static_cast<std::streamsize>(cacheDataOffset(levels.size()) - sizeof(header) - table.size() * sizeof(CacheLevel)));
+        for (const TextureView& level : levels)
+            file.write(reinterpret_cast<const char*>(level.texels), static_cast<std::streamsize>(levelTexelCount(level.width, level.height) * sizeof(Uint32)));
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            SDL_SetError("Couldn't write %s", temporaryPath.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error) {
+        std::remove(temporaryPath.c_str());
+        SDL_SetError("Couldn't write %s: %s", cachePath.c_str(), error.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Texture::loadFromCache(const std::string& cachePath, const std::string& sourcePath) {
+    reset();
+    SourceStamp stamp;
+    if (!readSourceStamp(sourcePath, stamp))
+        return false;
+    MappedFile file;
+    if (!file.open(cachePath))
+        return false;
+
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+        SDL_SetError("Texture cache %s is truncated", cachePath.c_str());
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.byteOrder != CACHE_BYTE_ORDER || header.blockBits != TEXTURE_BLOCK_BITS
+        || header.levelCount == 0 || header.levelCount > MAX_CACHE_LEVELS) {
+        SDL_SetError("%s is not a texture cache for this build", cachePath.c_str());
+        return false;
+    }
+    if (header.sourceSize != stamp.size || header.sourceTime != stamp.time) {
+        SDL_SetError("Texture cache %s is out of date for %s", cachePath.c_str(), sourcePath.c_str());
+        return false;
+    }
+    Uint64 dataOffset = cacheDataOffset(header.levelCount);
+    if (file.size() < dataOffset) {
+        SDL_SetError("Texture cache %s is truncated", cachePath.c_str());
+        return false;
+    }
+
+    // Accept exactly the layout saveCache() writes: a full chain of halving
+    // levels packed back to back, all inside the file
+    std::vector<CacheLevel> table(header.levelCount);
+    std::memcpy(table.data(), file.data() + sizeof(header), table.size() * sizeof(CacheLevel));
+    Uint64 offset = dataOffset;
+    for (Uint32 i = 0; i < header.levelCount; ++i) {
+        const CacheLevel& level = table[i];
+        bool sizeValid = i == 0 ? level.width > 0 && level.height > 0 && level.width <= 65536 && level.height <= 65536
+                                : level.width == std::max(table[i - 1].width / 2, 1u) && level.height == std::max(table[i - 1].height / 2, 1u);
+        bool isLast = i + 1 == header.levelCount;
+        Uint64 end = offset + levelTexelCount(static_cast<int>(level.width), static_cast<int>(level.height)) * sizeof(Uint32);
+        if (!sizeValid || level.offset != offset || end > file.size() || isLast != (level.width == 1 && level.height == 1)) {
+            levels.clear();
+            SDL_SetError("Texture cache %s is corrupt", cachePath.c_str());
+            return false;
+        }
+        const Uint32* texels = reinterpret_cast<const Uint32*>(file.data() + offset);
+        levels.push_back({texels, static_cast<int>(level.width), static_cast<int>(level.height), blocksFor(static_cast<int>(level.width))});
+        offset = end;
+    }
+    cache = std::move(file);
+    return true;
+}
@@ -0,0 +1,139 @@
+#include "texture_manager.h"
+
+#include <SDL_image.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const int PLACEHOLDER_SIZE = 64;
+const int PLACEHOLDER_SQUARE = 8;
+
+// Grey checkerboard, loaded like any other image so it has a mip chain
+void makePlaceholder(Texture& texture) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, PLACEHOLDER_SIZE, PLACEHOLDER_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface)
+        return;
+    SDL_LockSurface(surface);
+    for (int y = 0; y < PLACEHOLDER_SIZE; ++y) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch);
+        for (int x = 0; x < PLACEHOLDER_SIZE; ++x)
+            row[x] = ((x / PLACEHOLDER_SQUARE + y / PLACEHOLDER_SQUARE) & 1) ? 0xFF606060u : 0xFFA0A0A0u;
+    }
+    SDL_UnlockSurface(surface);
+    texture.loadFromSurface(surface);
+    SDL_FreeSurface(surface);
+}
+
+}
+
+TextureManager::TextureManager() {
+    makePlaceholder(placeholderTexture);
+    worker = std::thread(&TextureManager::workerLoop, this);
+}
+
+TextureManager::~TextureManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void TextureManager::request(const std::string& name, const std::string& path) {
+    if (entries.count(name))
+        return;
+    auto entry = std::make_unique<Entry>();
+    entry->name = name;
+    entry->path = path;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(entry.get());
+    }
+    entries.emplace(name, std::move(entry));
+    wake.notify_one();
+}
+
+const Texture& TextureManager::get(const std::string& name) const {
+    auto found = entries.find(name);
+    if (found == entries.end() || found->second->state.load(std::memory_order_acquire) != LoadState::Ready)
+        return placeholderTexture;
+    return found->second->texture;
+}
+
+const Texture* TextureManager::wait(const std::string& name) {
+    auto found = entries.find(name);
+    if (found == entries.end())
+        return nullptr;
+    Entry& entry = *found->second;
+    std::unique_lock<std::mutex> lock(mutex);
+    loaded.wait(lock, [&] { return entry.state.load(std::memory_order_acquire) != LoadState::Queued; });
+    return entry.state.load(std::memory_order_acquire) == LoadState::Ready ? &entry.texture : nullptr;
+}
+
+void TextureManager::workerLoop() {
+    for (;;) {
+        Entry* entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            entry = queue.front();
+            queue.pop_front();
+        }
+
+        bool decoded = false;
+        LoadState state = load(*entry, decoded) ? LoadState::Ready : LoadState::Failed;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry->state.store(state, std::memory_order_release);
+        }
+        loaded.notify_all();
+
+        // The texture no longer changes, so the cache is written from it
+        // while the renderer is already drawing with it
+        if (decoded)
+            writeCache(*entry);
+    }
+}
+
+bool TextureManager::load(Entry& entry, bool& decoded) {
+    auto start = std::chrono::steady_clock::now();
+    std::string cachePath = entry.path + TEXTURE_CACHE_SUFFIX;
+    std::string source;
+
+    if (entry.texture.loadFromCache(cachePath, entry.path)) {
+        source = "mapped " + cachePath;
+    } else {
+        SDL_Surface* surface = IMG_Load(entry.path.c_str());
+        bool converted = surface && entry.texture.loadFromSurface(surface);
+        if (surface)
+            SDL_FreeSurface(surface);
+        if (!converted) {
+            std::ostringstream message;
+            message << "Failed to load texture " << entry.name << " from " << entry.path << ": " << SDL_GetError() << "\n";
+            std::cerr << message.str();
+            return false;
+        }
+        source = "decoded " + entry.path;
+        decoded = true;
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::ostringstream message;
+    message << "Texture " << entry.name << " ready in " << milliseconds << " ms (" << source << ")\n";
+    std::cerr << message.str();
+    return true;
+}
+
+void TextureManager::writeCache(const Entry& entry) {
+    std::string cachePath = entry.path + TEXTURE_CACHE_SUFFIX;
+    if (!entry.texture.saveCache(cachePath, entry.path)) {
+        std::ostringstream message;
+        message << "Texture cache " << cachePath << " not written: " << SDL_GetError() << "\n";
+        std::cerr << message.str();
+    }
+}
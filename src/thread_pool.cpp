@@ -0,0 +1,82 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount) {
+    threadCount = std::max(threadCount, 1);
+    for (int i = 0; i < threadCount; ++i)
+        queues.push_back(std::make_unique<TaskQueue>());
+    for (int i = 1; i < threadCount; ++i)
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::run(int taskCount, const Task& task) {
+    if (taskCount <= 0)
+        return;
+
+    // Hand out contiguous blocks so neighbouring tiles stay on one thread
+    int workerCount = threadCount();
+    for (int i = 0; i < workerCount; ++i) {
+        queues[i]->next.store(static_cast<int>(static_cast<long long>(taskCount) * i / workerCount), std::memory_order_relaxed);
+        queues[i]->end = static_cast<int>(static_cast<long long>(taskCount) * (i + 1) / workerCount);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        activeWorkers = workerCount - 1;
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return activeWorkers == 0; });
+    currentTask = nullptr;
+}
+
+void ThreadPool::workerLoop(int worker) {
+    unsigned seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+
+        drain(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0)
+            finished.notify_one();
+    }
+}
+
+void ThreadPool::drain(int worker) {
+    const Task& task = *currentTask;
+    int workerCount = threadCount();
+
+    // Own block first, then the other blocks in order starting with the next worker
+    for (int offset = 0; offset < workerCount; ++offset) {
+        TaskQueue& queue = *queues[(worker + offset) % workerCount];
+        for (;;) {
+            int index = queue.next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= queue.end)
+                break;
+            task(index, worker);
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include "tile_renderer.h"
+
+#include <algorithm>
+
+namespace {
+
+// True when the whole tile lies outside one of the edges. The edge function
+// is linear, so testing the corner pixel it is largest at is enough.
+bool tileOutsideTriangle(const TriangleSetup& setup, const ClipRect& tile) {
+    for (const EdgeFunction& edge : setup.edges) {
+        int x = edge.a > 0 ? tile.x1 - 1 : tile.x0;
+        int y = edge.b > 0 ? tile.y1 - 1 : tile.y0;
+        if (edge.c + edge.a * x + edge.b * y < 0)
+            return true;
+    }
+    return false;
+}
+
+void clearRect(Framebuffer& framebuffer, const ClipRect& rect, Uint32 clearColor) {
+    if (rect.x0 == 0 && rect.y0 == 0 && rect.x1 == framebuffer.width && rect.y1 == framebuffer.height) {
+        framebuffer.clear(clearColor);
+        return;
+    }
+    for (int y = rect.y0; y < rect.y1; ++y)
+        std::fill(framebuffer.row(y) + rect.x0, framebuffer.row(y) + rect.x1, clearColor);
+}
+
+}
+
+TileRenderer::TileRenderer(int width, int height, ThreadPool* pool)
+    : width(width), height(height), pool(pool) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    bins.resize(static_cast<size_t>(tilesX) * tilesY);
+    workerProfiles.resize(pool ? pool->threadCount() : 1);
+}
+
+void TileRenderer::beginFrame() {
+    triangles.clear();
+    for (std::vector<int>& bin : bins)
+        bin.clear();
+}
+
+void TileRenderer::addTriangle(const DrawTriangle& triangle) {
+    triangles.push_back(triangle);
+    if (pool)
+        binTriangle(static_cast<int>(triangles.size()) - 1);
+}
+
+void TileRenderer::binTriangle(int index) {
+    const ClipRect& bounds = triangles[index].setup.bounds;
+    int tileX0 = std::max(bounds.x0, 0) / TILE_SIZE;
+    int tileY0 = std::max(bounds.y0, 0) / TILE_SIZE;
+    int tileX1 = std::min((bounds.x1 - 1) / TILE_SIZE, tilesX - 1);
+    int tileY1 = std::min((bounds.y1 - 1) / TILE_SIZE, tilesY - 1);
+    for (int tileY = tileY0; tileY <= tileY1; ++tileY) {
+        for (int tileX = tileX0; tileX <= tileX1; ++tileX) {
+            int tile = tileY * tilesX + tileX;
+            if (!tileOutsideTriangle(triangles[index].setup, tileRect(tile)))
+                bins[tile].push_back(index);
+        }
+    }
+}
+
+ClipRect TileRenderer::tileRect(int tile) const {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    return {x0, y0, std::min(x0 + TILE_SIZE, width), std::min(y0 + TILE_SIZE, height)};
+}
+
+void TileRenderer::render(Framebuffer& framebuffer, Uint32 clearColor, FrameProfile* profile) {
+    if (profile) {
+        for (WorkerProfile& worker : workerProfiles) {
+            worker.coverageNanoseconds = 0;
+            worker.shadingNanoseconds = 0;
+            worker.coveredPixels = 0;
+        }
+    }
+
+    if (!pool) {
+        const ClipRect screen = {0, 0, width, height};
+        if (profile) {
+            allTriangles.resize(triangles.size());
+            for (size_t i = 0; i < triangles.size(); ++i)
+                allTriangles[i] = static_cast<int>(i);
+            renderTileProfiled(framebuffer, clearColor, screen, allTriangles, workerProfiles[0]);
+        } else {
+            framebuffer.clear(clearColor);
+            for (const DrawTriangle& triangle : triangles) {
+                rasterizeTriangle(triangle.setup, screen, [&](int y, int x0, int x1) {
+                    shadeSpan(framebuffer, triangle, y, x0, x1);
+                });
+            }
+        }
+    } else if (profile) {
+        pool->run(tilesX * tilesY, [&](int tile, int worker) {
+            renderTileProfiled(framebuffer, clearColor, tileRect(tile), bins[tile], workerProfiles[worker]);
+        });
+    } else {
+        pool->run(tilesX * tilesY, [&](int tile, int) {
+            renderTile(framebuffer, clearColor, tile);
+        });
+    }
+
+    if (profile) {
+        for (const WorkerProfile& worker : workerProfiles) {
+            profile->add(ProfileStage::Coverage, worker.coverageNanoseconds);
+            profile->add(ProfileStage::Shading, worker.shadingNanoseconds);
+            profile->coveredPixels += worker.coveredPixels;
+        }
+    }
+}
+
+void TileRenderer::renderTile(Framebuffer& framebuffer, Uint32 clearColor, int tile) const {
+    ClipRect rect = tileRect(tile);
+    clearRect(framebuffer, rect, clearColor);
+
+    for (int index : bins[tile]) {
+        const DrawTriangle& triangle = triangles[index];
+        rasterizeTriangle(triangle.setup, rect, [&](int y, int x0, int x1) {
+            shadeSpan(framebuffer, triangle, y, x0, x1);
+        });
+    }
+}
+
+void TileRenderer::renderTileProfiled(Framebuffer& framebuffer, Uint32 clearColor, const ClipRect& rect, const std::vector<int>& indices, WorkerProfile& profile) const {
+    int64_t start = profileNow();
+    profile.spans.clear();
+    for (int index : indices) {
+        rasterizeTriangle(triangles[index].setup, rect, [&](int y, int x0, int x1) {
+            profile.spans.push_back({index, y, x0, x1});
+            profile.coveredPixels += x1 - x0;
+        });
+    }
+    int64_t covered = profileNow();
+
+    // The clear counts as shading: it is the other pass writing the tile
+    clearRect(framebuffer, rect, clearColor);
+    for (const CoveredSpan& span : profile.spans)
+        shadeSpan(framebuffer, triangles[span.triangle], span.y, span.x0, span.x1);
+    int64_t shaded = profileNow();
+
+    profile.coverageNanoseconds += covered - start;
+    profile.shadingNanoseconds += shaded - covered;
+}
+
+void TileRenderer::shadeSpan(Framebuffer& framebuffer, const DrawTriangle& triangle, int y, int x0, int x1) const {
+    // Pick mip levels per tile-aligned segment so a span cut by tile
+    // edges shades exactly like the same span in the reference path
+    Uint32* row = framebuffer.row(y);
+    while (x0 < x1) {
+        int segmentEnd = std::min((x0 / TILE_SIZE + 1) * TILE_SIZE, x1);
+        int level = selectMipLevel(triangle.setup, triangle.mode, *triangle.texture, y, x0, segmentEnd);
+        triangle.shader(triangle.setup, triangle.texture->level(level), y, x0, segmentEnd, row);
+        x0 = segmentEnd;
+    }
+}